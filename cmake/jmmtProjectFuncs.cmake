@@ -17,3 +17,17 @@ function(jmmt_simple_test target_name)
     jmmt_target(${target_name})
     mco_nounit_add_test(${target_name})
 endfunction()
+
+# Declares a simple benchmark target. Benchmarks are plain executables
+# which print their timings; they aren't registered as tests.
+function(jmmt_simple_benchmark target_name)
+    add_executable(${target_name}
+        ${target_name}.cpp
+    )
+
+    target_link_libraries(${target_name} PRIVATE
+        jmmt::libjmmt
+    )
+
+    jmmt_target(${target_name})
+endfunction()
@@ -1,14 +1,70 @@
 #pragma once
+#include <jmmt/fixed_string.hpp>
 #include <mco/base_types.hpp>
+#include <span>
+#include <string_view>
 
 namespace jmmt {
 
 	using Crc32Result = u32;
 
-	/// Hash a string.
-	Crc32Result hashString(std::string_view str);
+	namespace impl {
+		/// Hashes [str] a bit at a time, for constant evaluation. This is far too slow for runtime use, where
+		/// the table driven [hashStringRuntime] and [hashStringCaseRuntime] are used instead.
+		template <bool FoldCase>
+		constexpr Crc32Result hashStringConstexpr(std::string_view str) {
+			Crc32Result crc = 0;
+			for(auto c : str) {
+				auto byte = static_cast<u8>(c);
+				if constexpr(FoldCase)
+					byte &= ~0x20;
+
+				crc ^= byte;
+				for(u32 i = 0; i < 8; ++i)
+					crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+			}
+			return crc;
+		}
+
+		Crc32Result hashStringRuntime(std::string_view str);
+		Crc32Result hashStringCaseRuntime(std::string_view str);
+	} // namespace impl
+
+	/// Hash a string. This can be used in constant expressions, so the hashes of
+	/// well-known names can be computed at compile time (see also [NameHash]).
+	constexpr Crc32Result hashString(std::string_view str) {
+		if consteval {
+			return impl::hashStringConstexpr<true>(str);
+		} else {
+			return impl::hashStringRuntime(str);
+		}
+	}
 
 	/// Hash a string (case-sensitive version).
-	Crc32Result hashStringCase(std::string_view str);
+	constexpr Crc32Result hashStringCase(std::string_view str) {
+		if consteval {
+			return impl::hashStringConstexpr<false>(str);
+		} else {
+			return impl::hashStringCaseRuntime(str);
+		}
+	}
+
+	/// The [hashString] of [name], computed at compile time.
+	template <FixedString name>
+	constexpr Crc32Result NameHash = hashString(std::string_view(name, name.length()));
+
+	/// Hash many strings at once, writing the hash of each string in [strings] to the same index in [hashes]
+	/// (which must be at least as large). Gives the same results as [hashString], but is faster for many short strings.
+	void hashStrings(std::span<const std::string_view> strings, std::span<Crc32Result> hashes);
+
+	/// Like [hashStrings], but case-sensitive (see [hashStringCase]).
+	void hashStringsCase(std::span<const std::string_view> strings, std::span<Crc32Result> hashes);
+
+	namespace literals {
+		/// `"name"_hash` is the [hashString] of "name", computed at compile time. Handy for case labels.
+		consteval Crc32Result operator""_hash(const char* pString, usize length) {
+			return hashString(std::string_view(pString, length));
+		}
+	} // namespace literals
 
 } // namespace jmmt
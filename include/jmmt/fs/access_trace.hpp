@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <mco/base_types.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// One read recorded in an [AccessTrace].
+	struct AccessTraceEntry {
+		/// The name of the file read from.
+		std::string fileName;
+
+		/// Where in the file the read started, and how many bytes it returned.
+		u32 offset;
+		u32 length;
+
+		/// When the read happened, relative to when recording started.
+		std::chrono::nanoseconds timestamp;
+	};
+
+	/// A trace of the reads done on a package, in the order they happened. Recorded with
+	/// [PakFileSystem::startAccessTrace], and replayed as a prefetch plan with [PakFileSystem::setPrefetchPlan].
+	struct AccessTrace {
+		std::vector<AccessTraceEntry> entries;
+
+		/// Saves the trace to [path], as text (one read per line). Returns true on success.
+		bool save(const std::filesystem::path& path) const;
+
+		/// Loads a trace saved by [save]. Returns an empty optional if the file can't be read or is malformed.
+		static std::optional<AccessTrace> load(const std::filesystem::path& path);
+	};
+
+} // namespace jmmt::fs
@@ -1,21 +1,37 @@
 #pragma once
+#include <chrono>
 #include <filesystem>
+#include <functional>
 #include <jmmt/fs/package_metadata.hpp>
+#include <jmmt/fs/package_toc.hpp>
+#include <jmmt/fs/pak_file_stream.hpp>
+#include <jmmt/fs/pak_filesystem.hpp>
+#include <jmmt/fs/stats.hpp>
 #include <jmmt/game_version.hpp>
 #include <mco/base_types.hpp>
 #include <mco/io/file_stream.hpp>
 #include <mco/pimple_container.hpp>
+#include <optional>
+#include <string_view>
 #include <unordered_map>
 
 namespace jmmt::fs {
-
-	class PakFileSystem;
+	class StatsCounters;
+	class MemoryBudget;
 
 	/// This class wraps accessing the filesystem as extracted from the disc.
 	class GameFileSystem : public std::enable_shared_from_this<GameFileSystem> {
 		class Impl;
 		Unique<Impl> impl;
 
+		friend class PakFileSystem;
+
+		/// Returns the counters packages opened through this filesystem record their statistics into.
+		StatsCounters& getStatsCounters();
+
+		/// Returns the memory budget packages opened through this filesystem draw from.
+		MemoryBudget& getMemoryBudget();
+
 	   public:
 		enum FileType {
 			FileData,
@@ -31,6 +47,11 @@ namespace jmmt::fs {
 		/// Initalize the game file system. Returns true if it was successfully initialized.
 		bool initialize();
 
+		/// Makes [initialize] skip version detection and assume the filesystem is [version].
+		/// Version detection needs the game's ELF, so this is meant for tests and synthetic
+		/// filesystems (see jmmt/synth), which don't have one. Must be called before [initialize].
+		void setAssumedVersion(GameVersion version);
+
 		/// Returns true if the filesystem is valid.
 		bool isValidFilesystem() const;
 
@@ -39,14 +60,93 @@ namespace jmmt::fs {
 		GameVersion getVersion() const;
 
 		/// Gets metadata of all package files that are in this filesystem.
-		/// Not directly useful (intended for the pak file system), but public just in case.
-		const std::unordered_map<std::string, PackageMetadata>& getPackageMetadata() const;
+		/// Not directly useful (intended for the pak file system), but public just in case. See [PackageToc].
+		const PackageToc& getPackageMetadata() const;
 
 		/// Opens a package file. Returns a Ref<> to the package filesystem.
-		Ref<PakFileSystem> openPackageFile(const std::string& packageFileName);
+		Ref<PakFileSystem> openPackageFile(const std::string& packageFileName, PakFileSystem::InitMode mode = PakFileSystem::InitEager);
+
+		/// Opens every package file listed in package.toc, initializing them concurrently on
+		/// [nThreads] worker threads (0 uses one per hardware thread). Returns the packages keyed by name;
+		/// packages which fail to initialize are left out. Each package's initialization time is available
+		/// through [PakFileSystem::getInitializationTime].
+		std::unordered_map<std::string, Ref<PakFileSystem>> openAllPackages(u32 nThreads = 0);
+
+		/// Builds the game file index, which maps every file in every package to the package holding it.
+		/// If index caching is enabled (see [setIndexCachePath]) and a saved game file index matches the packages,
+		/// it's loaded from there; otherwise every package is opened lazily on [nThreads] worker threads (0 uses one
+		/// per hardware thread) and the index is saved for next time. Packages which fail to open are left out
+		/// of the index. Returns false if no index could be built.
+		bool buildFileIndex(u32 nThreads = 0);
+
+		/// Returns true if [buildFileIndex] has built the game file index.
+		bool hasFileIndex() const;
+
+		/// Returns the name of the package holding [fileName], or an empty optional if no package does (or the file
+		/// index hasn't been built). This is a single hash lookup; most names which aren't in any package are turned
+		/// away by a Bloom filter without even that. If more than one package has a file of the same name, the package
+		/// whose name sorts first wins.
+		std::optional<std::string_view> findFilePackage(std::string_view fileName) const;
+
+		/// Opens [fileName] from whichever package holds it, according to the file index. Returns a null pointer
+		/// if no package does. Packages are opened lazily the first time a file in them is opened, and stay open
+		/// for as long as a stream on one of their files is alive.
+		///
+		/// Like packages themselves, the file index isn't safe to use from more than one thread at once: this,
+		/// [findFilePackage] and [buildFileIndex] must not be called concurrently.
+		Unique<PakFileStream> openPackagedFile(std::string_view fileName);
 
 		/// Opens a file from the game filesystem. Only opens for reading.
 		mco::FileStream openFile(const std::string& filename, FileType type = FileData);
+
+		/// Resolves the path on disk that [openFile] would open for the given file. Files are resolved from
+		/// a listing of the game's folders made by [initialize], without touching the filesystem; a file which
+		/// isn't listed resolves to the path of its clear name.
+		std::filesystem::path getFilePath(const std::string& filename, FileType type = FileData) const;
+
+		/// Lists the game's folders again, so that files added or removed since [initialize] (or the last rescan)
+		/// resolve correctly. Returns false if a folder couldn't be listed; files in it are then resolved by probing
+		/// the filesystem instead.
+		bool rescanDirectories();
+
+		/// Sets the directory package index caches are kept in. An empty path (the default)
+		/// disables index caching. When enabled, packages save their parsed index to a sidecar file
+		/// in this directory, which later opens of the same package can map instead of re-parsing. If this is set
+		/// before [initialize], version detection also caches the digest of the game's ELF here, so later
+		/// filesystems on the same game skip hashing it.
+		void setIndexCachePath(const std::filesystem::path& path);
+
+		/// Returns the package index cache directory, or an empty path if index caching is disabled.
+		const std::filesystem::path& getIndexCachePath() const;
+
+		/// Sets the directory decompressed package images are kept in. An empty path (the default)
+		/// disables image caching. When enabled, [PakFileSystem::writeImageCache] saves an image of a package's
+		/// decompressed data to this directory; later opens of the same package serve reads straight from
+		/// a mapping of the image, without any decoding.
+		void setImageCachePath(const std::filesystem::path& path);
+
+		/// Returns the package image cache directory, or an empty path if image caching is disabled.
+		const std::filesystem::path& getImageCachePath() const;
+
+		/// Limits the memory this filesystem and every package opened through it hold for buffers, indices and caches
+		/// to about [bytes] (0, the default, means no limit). Memory needed to read at all is always allocated, even past
+		/// the limit; once the limit is reached, optional memory is done without instead. Files read ahead a single chunk
+		/// at a time instead of filling their whole read buffer (see [PakFileSystem::setMaxReadSize]), and prefetchers hold
+		/// fewer chunks, leaving the rest for the files to decode themselves. Current and peak usage are in [getStats].
+		void setMemoryLimit(u64 bytes);
+
+		/// Returns the memory limit, or 0 if there is none.
+		u64 getMemoryLimit() const;
+
+		/// Returns a snapshot of the statistics of every package opened through this filesystem.
+		Stats getStats() const;
+
+		/// Calls [callback] with a snapshot of [getStats] every [interval], from a background thread,
+		/// until [stopStatsDump] is called or the filesystem is destroyed. Replaces any previous dump.
+		void startStatsDump(std::chrono::milliseconds interval, std::function<void(const Stats&)> callback);
+
+		/// Stops periodic statistics dumps started by [startStatsDump].
+		void stopStatsDump();
 	};
 
 	/// Creates a [GameFileSystem] instance for the path specified in [path].
@@ -54,4 +154,8 @@ namespace jmmt::fs {
 	/// frees the instance when it fails to initalize properly.
 	Ref<GameFileSystem> createGameFileSystem(const std::filesystem::path& path);
 
+	/// Like [createGameFileSystem], but skips version detection and assumes the filesystem is [assumedVersion].
+	/// See [GameFileSystem::setAssumedVersion].
+	Ref<GameFileSystem> createGameFileSystem(const std::filesystem::path& path, GameVersion assumedVersion);
+
 } // namespace jmmt::fs
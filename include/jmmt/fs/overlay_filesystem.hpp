@@ -0,0 +1,79 @@
+#pragma once
+#include <filesystem>
+#include <jmmt/fs/game_filesystem.hpp>
+#include <jmmt/fs/pak_filesystem.hpp>
+#include <mco/base_types.hpp>
+#include <mco/io/stream.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// Merges directories of loose files with packages, so that loose files shadow the package files of the
+	/// same name without repacking anything. Useful for mods, and for trying out changed files quickly.
+	///
+	/// Names are resolved like the game resolves package file names: by their [hashString], so case doesn't
+	/// matter. Every source's files are hashed into a single table up front, so resolving a name is a single
+	/// lookup no matter how many sources there are, and loose roots aren't touched until a loose file is
+	/// opened. Loose roots are only scanned when added, or when [rescanLooseRoots] is called.
+	class OverlayFileSystem {
+		struct Impl;
+		Unique<Impl> impl;
+
+	   public:
+		/// Where a file resolved to.
+		struct Resolution {
+			/// The path of the loose file, if the file is loose. Empty otherwise.
+			std::filesystem::path loosePath;
+
+			/// The package the file is in, the package's name, and the name the package stores the file
+			/// under, if the file is in a package.
+			Ref<PakFileSystem> package;
+			std::string packageName;
+			std::string packageFileName;
+
+			bool isLoose() const {
+				return !loosePath.empty();
+			}
+		};
+
+		explicit OverlayFileSystem(Ref<GameFileSystem> fs);
+		~OverlayFileSystem();
+
+		OverlayFileSystem(const OverlayFileSystem&) = delete;
+
+		/// Adds a directory of loose files. Files are named by their path relative to [root], with backslashes as
+		/// separators (like the game's file names). Loose files shadow every package, and roots added later shadow
+		/// roots added earlier. Returns false if [root] couldn't be listed.
+		bool addLooseRoot(const std::filesystem::path& root);
+
+		/// Scans every loose root again, picking up files added or removed since they were last scanned.
+		/// Returns false if a root couldn't be listed.
+		bool rescanLooseRoots();
+
+		/// Opens a package from the game filesystem and adds its files. Packages added later shadow packages
+		/// added earlier. Returns false if the package couldn't be opened.
+		bool addPackage(const std::string& packageName, PakFileSystem::InitMode mode = PakFileSystem::InitEager);
+
+		/// Adds every package listed in package.toc, in name order. Returns false if a package couldn't be opened.
+		bool addAllPackages(PakFileSystem::InitMode mode = PakFileSystem::InitEager);
+
+		/// Resolves [name] to the loose file or package file it refers to, or returns an empty optional if there
+		/// isn't one. Forward slashes in [name] are treated as backslashes.
+		std::optional<Resolution> resolve(std::string_view name) const;
+
+		/// Returns true if [name] resolves to a file.
+		bool exists(std::string_view name) const;
+
+		/// Opens a stream on the file [name] resolves to, or returns a null pointer if it doesn't resolve
+		/// or couldn't be opened.
+		Unique<mco::Stream> openFile(std::string_view name);
+
+		/// Reads the whole of the file [name] resolves to. Returns an empty optional if it doesn't resolve
+		/// or couldn't be read.
+		std::optional<std::vector<u8>> readWholeFile(std::string_view name);
+	};
+
+} // namespace jmmt::fs
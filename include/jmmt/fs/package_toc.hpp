@@ -0,0 +1,59 @@
+#pragma once
+#include <filesystem>
+#include <jmmt/fs/package_metadata.hpp>
+#include <jmmt/structs/package_toc.hpp>
+#include <mco/base_types.hpp>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// The packages listed in package.toc. The file is read in a single read, and entries refer to
+	/// names in that buffer, so loading it doesn't allocate anything per package. Packages are found
+	/// by the hash of their name.
+	///
+	/// Since entries point into the table's own buffer, tables can be moved but not copied.
+	class PackageToc {
+	   public:
+		struct Entry {
+			std::string_view name;
+			PackageMetadata metadata;
+		};
+
+	   private:
+		std::vector<structs::PackageTocHeader> headers;
+		std::vector<Entry> entries;
+
+		/// (name hash, index into [entries]) of every entry, sorted.
+		std::vector<std::pair<u32, u32>> hashIndex;
+
+	   public:
+		PackageToc() = default;
+		PackageToc(const PackageToc&) = delete;
+		PackageToc& operator=(const PackageToc&) = delete;
+		PackageToc(PackageToc&&) = default;
+		PackageToc& operator=(PackageToc&&) = default;
+
+		/// Loads package.toc from [path], replacing anything loaded before. If a package is listed more
+		/// than once, the last entry wins. Returns false (leaving the table empty) if the file couldn't be read.
+		bool load(const std::filesystem::path& path);
+
+		/// Returns the metadata of the package named [name], or a null pointer if it isn't listed.
+		const PackageMetadata* find(std::string_view name) const;
+
+		usize size() const {
+			return entries.size();
+		}
+
+		/// Iterates the packages, in the order package.toc lists them.
+		auto begin() const {
+			return entries.begin();
+		}
+
+		auto end() const {
+			return entries.end();
+		}
+	};
+
+} // namespace jmmt::fs
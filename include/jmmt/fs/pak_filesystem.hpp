@@ -1,7 +1,15 @@
 #pragma once
+#include <chrono>
+#include <iterator>
+#include <jmmt/fs/access_trace.hpp>
 #include <jmmt/fs/package_metadata.hpp>
+#include <jmmt/fs/stats.hpp>
 #include <mco/base_types.hpp>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace jmmt::fs {
 	class GameFileSystem;
@@ -9,21 +17,126 @@ namespace jmmt::fs {
 	class PakFileSystem : public std::enable_shared_from_this<PakFileSystem> {
 		struct Impl;
 		Unique<Impl> impl;
+		std::chrono::nanoseconds initializationTime {};
 
 	   public:
 		using FileHandle = i32;
 
-		/// Public metadata.
+		/// Public metadata. The strings are views into the package's string pool,
+		/// so they remain valid for as long as the package filesystem does.
 		struct Metadata {
-			std::string sourceName;
-			std::string sourceConvertName;
-			std::string sourceCompressName;
-			std::string typeName;
+			std::string_view sourceName;
+			std::string_view sourceConvertName;
+			std::string_view sourceCompressName;
+			std::string_view typeName;
 
 			u32 fileSize;
 			u32 dateStamp; // It is currently unknown what this date stamp is.
 		};
 
+		/// A view of a file in the package, as yielded by [enumerateFiles].
+		struct FileEntry {
+			/// The name of the file. Like the strings in [metadata], this is a view into the package's string pool.
+			std::string_view name;
+
+			Metadata metadata;
+
+			/// Offset in the .pak file where the file's first chunk starts.
+			u32 dataOffset;
+		};
+
+		enum SortOrder {
+			/// Files are enumerated in the package index's own order (sorted by the hash of their name).
+			SortNone = 0,
+
+			/// Files are enumerated sorted by name.
+			SortByName,
+
+			/// Files are enumerated sorted by where their data starts in the .pak file.
+			/// Reading files in this order reads the package sequentially.
+			SortByOffset
+		};
+
+		/// Iterator over the files of a package. Dereferencing it builds a [FileEntry] directly
+		/// from the package index, so iterating doesn't allocate.
+		class FileIterator {
+			friend class PakFileSystem;
+
+			const Impl* pImpl = nullptr;
+			const u32* pOrder = nullptr;
+			u32 position = 0;
+
+			FileIterator(const Impl* pImpl, const u32* pOrder, u32 position)
+				: pImpl(pImpl), pOrder(pOrder), position(position) {
+			}
+
+		   public:
+			using iterator_concept = std::forward_iterator_tag;
+			using value_type = FileEntry;
+			using difference_type = std::ptrdiff_t;
+
+			FileIterator() = default;
+
+			FileEntry operator*() const;
+
+			FileIterator& operator++() {
+				++position;
+				return *this;
+			}
+
+			FileIterator operator++(int) {
+				auto copy = *this;
+				++position;
+				return copy;
+			}
+
+			bool operator==(const FileIterator& other) const {
+				return position == other.position;
+			}
+		};
+
+		/// A range of the files in a package. See [enumerateFiles].
+		class FileRange {
+			friend class PakFileSystem;
+
+			const Impl* pImpl = nullptr;
+			const u32* pOrder = nullptr;
+			u32 count = 0;
+
+			FileRange(const Impl* pImpl, const u32* pOrder, u32 count)
+				: pImpl(pImpl), pOrder(pOrder), count(count) {
+			}
+
+		   public:
+			FileIterator begin() const {
+				return { pImpl, pOrder, 0 };
+			}
+
+			FileIterator end() const {
+				return { pImpl, pOrder, count };
+			}
+
+			usize size() const {
+				return count;
+			}
+
+			bool empty() const {
+				return count == 0;
+			}
+		};
+
+		enum InitMode {
+			/// Index every file in the package when initializing.
+			InitEager = 0,
+
+			/// Only record where each file's metadata is when initializing. A file's metadata is
+			/// built the first time it's opened or queried, and the string table is read the first time
+			/// file names are needed. Useful when only a few files will be used out of a large package.
+			/// Since opening or querying a file can build its metadata, a lazily initialized package
+			/// mustn't be used from more than one thread at once.
+			InitLazy
+		};
+
 		enum SeekOrigin {
 			SeekBegin = 0,
 			SeekCurrent,
@@ -41,13 +154,45 @@ namespace jmmt::fs {
 			FileNotExist = -1,
 		};
 
+		/// The default for [setMaxReadSize].
+		constexpr static u32 DefaultMaxReadSize = 1024 * 1024;
+
+		/// The default for the [maxPrefetchBytes] argument of [setPrefetchPlan].
+		constexpr static u64 DefaultMaxPrefetchBytes = 16 * 1024 * 1024;
+
 		explicit PakFileSystem(Ref<GameFileSystem> fs, const PackageMetadata& metadata, const std::string& fileName);
 		~PakFileSystem();
 
-		Error initialize();
+		Error initialize(InitMode mode = InitEager);
+
+		/// Returns how long [initialize] took, for diagnostics.
+		std::chrono::nanoseconds getInitializationTime() const;
+
+		/// Returns a snapshot of this package's statistics.
+		Stats getStats() const;
+
+		/// Sets the largest amount of data that will be read from the .pak file at once.
+		/// A file's chunks are usually stored back to back, so reading a file reads as many of its
+		/// chunks as fit in this size with a single read. Only affects files opened afterwards.
+		void setMaxReadSize(u32 size);
+		u32 getMaxReadSize() const;
+
+		/// Get file metadata. Names are views into the package's string pool.
+		/// This builds (once) a map of every file's metadata; prefer [enumerateFiles] for
+		/// listing and scanning files, which doesn't need to copy anything.
+		const std::unordered_map<std::string_view, PakFileSystem::Metadata>& getMetadata();
 
-		/// Get file metadata
-		const std::unordered_map<std::string, PakFileSystem::Metadata>& getMetadata();
+		/// Enumerates the files in this package, in the given [order]. The range refers directly to
+		/// the package index, and remains valid for as long as this package filesystem does.
+		/// Each sorted order is computed once, the first time it's requested.
+		FileRange enumerateFiles(SortOrder order = SortNone);
+
+		/// Gets the metadata of a single file, or an empty optional if it doesn't exist.
+		std::optional<Metadata> getFileMetadata(const std::string_view path);
+
+		/// Returns the [hashString] of the name of every file in this package, in no particular order.
+		/// Unlike [enumerateFiles], this doesn't need lazily initialized packages to be fully indexed.
+		std::vector<u32> getFileNameHashes() const;
 
 		/// Opens a new pak file.
 		FileHandle fileOpen(const std::string_view path);
@@ -66,6 +211,42 @@ namespace jmmt::fs {
 
 		/// Closes a previously-owned pak file.
 		void fileClose(FileHandle file);
+
+		/// Reads the whole of a file. Returns an empty optional if the file doesn't exist or couldn't be read.
+		std::optional<std::vector<u8>> readWholeFile(const std::string_view path);
+
+		/// Returns a view of a file's decompressed data in this package's image (see [GameFileSystem::setImageCachePath]),
+		/// or an empty optional if the package has no image or the file doesn't exist. The view points straight into
+		/// a read-only mapping of the image, and remains valid for as long as this package filesystem does.
+		std::optional<std::span<const u8>> getImageFileData(const std::string_view path);
+
+		/// Returns true if this package is served from an image.
+		bool hasImage() const;
+
+		/// Returns true once every file in this package has been read in full (and it isn't served from an image).
+		/// Since such a package is likely to be read in full again, that's a good time to [writeImageCache].
+		bool isFullyRead() const;
+
+		/// Decodes every file in this package, and writes an image of them to the game filesystem's image cache
+		/// directory. Files opened afterwards are served from the image. Images are never written implicitly,
+		/// since this decodes the whole package. Does nothing (and returns true) if the package is already
+		/// served from an image. Returns false if image caching is disabled, or the image couldn't be written.
+		bool writeImageCache();
+
+		/// Starts recording an access trace of every [fileRead] on this package. Any trace being recorded is discarded.
+		void startAccessTrace();
+
+		/// Stops recording the access trace, and returns it.
+		AccessTrace stopAccessTrace();
+
+		/// Sets a prefetch plan, usually an access trace recorded by an earlier run. The chunks the trace's reads touched
+		/// are read and decoded on a background thread, in the order they were read, so that they're ready by the time
+		/// the files are read again. At most [maxPrefetchBytes] of decoded data is held ahead of the reads; if the reads
+		/// stray from the plan, chunks they skip past are dropped. Only affects files opened afterwards.
+		void setPrefetchPlan(const AccessTrace& trace, u64 maxPrefetchBytes = DefaultMaxPrefetchBytes);
+
+		/// Stops using the prefetch plan. Files already open keep using it until they're closed.
+		void clearPrefetchPlan();
 	};
 
 } // namespace jmmt::fs
@@ -0,0 +1,186 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <jmmt/fs/access_trace.hpp>
+#include <jmmt/fs/package_metadata.hpp>
+#include <mco/base_types.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// Optional information about a file written by [PakWriter].
+	struct PakWriterFileInfo {
+		/// The type of the file (e.g. "Texture").
+		std::string typeName;
+
+		/// The source file names the game's tools record. Empty source names default to the file name,
+		/// and empty convert/compress names default to the source name.
+		std::string sourceName;
+		std::string sourceConvertName;
+		std::string sourceCompressName;
+
+		u32 dateStamp = 0;
+	};
+
+	/// Builds .pak files. Files are split into 64 KiB chunks, which are LZSS compressed in parallel
+	/// (chunks which don't get smaller are stored as-is). The output only depends on the files
+	/// added and the order they were added in, not the amount of threads used.
+	class PakWriter {
+		struct Impl;
+		Unique<Impl> impl;
+
+	   public:
+		/// Fills the span with a file's data. Returns false on failure.
+		/// Data sources may be called from any thread, and concurrently with other data sources.
+		using DataSource = std::function<bool(std::span<u8>)>;
+
+		using FileInfo = PakWriterFileInfo;
+
+		enum Error {
+			Success = 0,
+
+			/// Two files have the same name (names are case-insensitive).
+			DuplicateFile,
+
+			/// A file is too large to be stored in a package.
+			FileTooLarge,
+
+			/// The package would be larger than 4 GiB.
+			PackageTooLarge,
+
+			/// Reading the data of a file failed.
+			ReadFailure,
+
+			/// Writing the package failed.
+			WriteFailure
+		};
+
+		/// The uncompressed size of every chunk but the last of a file.
+		constexpr static u32 ChunkSize = 65536;
+
+		PakWriter();
+		~PakWriter();
+
+		PakWriter(const PakWriter&) = delete;
+
+		/// Sets the name the package group is identified by. Defaults to the package file's name.
+		void setGroupName(std::string_view name);
+
+		/// Sets the amount of threads chunks are compressed on. 0 (the default) uses one per hardware thread.
+		void setThreadCount(u32 nThreads);
+
+		/// Adds a file with the given data.
+		void addFile(std::string_view name, std::vector<u8> data, FileInfo info = {});
+
+		/// Adds a file of [size] bytes, whose data is provided by [source] once the package is written.
+		void addFile(std::string_view name, u32 size, DataSource source, FileInfo info = {});
+
+		/// Adds a file on disk. Its data is read once the package is written.
+		/// Returns false if the file doesn't exist.
+		bool addFileFromDisk(std::string_view name, const std::filesystem::path& path, FileInfo info = {});
+
+		/// Adds every file under [directory]. Files are named by their path relative to [directory],
+		/// with backslashes as separators (like the game's file names), and added sorted by name.
+		/// Returns false if [directory] couldn't be listed.
+		bool addDirectory(const std::filesystem::path& directory);
+
+		/// Adds a string to the package's string table, without any file using it.
+		void addString(std::string_view string);
+
+		/// Returns the amount of files added.
+		usize getFileCount() const;
+
+		/// Writes the package to [path], and its package.toc metadata to [metadata]. The package is written to
+		/// a temporary file first and then moved into place, so [path] is left alone if writing fails.
+		Error write(const std::filesystem::path& path, PackageMetadata& metadata);
+	};
+
+	/// Updates existing .pak files in place. Instead of rewriting the whole package, the chunks of new or
+	/// changed files are appended to the end of it, followed by new header chunks and a new string table.
+	/// The data of unchanged files isn't touched, so an update only costs about as much as the files it
+	/// changes. Data of replaced or removed files is left behind as dead space, which [compactPackage]
+	/// reclaims.
+	class PakUpdater {
+		struct Impl;
+		Unique<Impl> impl;
+
+	   public:
+		using DataSource = PakWriter::DataSource;
+		using FileInfo = PakWriterFileInfo;
+		using Error = PakWriter::Error;
+
+		PakUpdater();
+		~PakUpdater();
+
+		PakUpdater(const PakUpdater&) = delete;
+
+		/// Sets the amount of threads chunks are compressed on. 0 (the default) uses one per hardware thread.
+		void setThreadCount(u32 nThreads);
+
+		/// Adds or replaces a file with the given data.
+		void addFile(std::string_view name, std::vector<u8> data, FileInfo info = {});
+
+		/// Adds or replaces a file of [size] bytes, whose data is provided by [source] once the package is updated.
+		void addFile(std::string_view name, u32 size, DataSource source, FileInfo info = {});
+
+		/// Adds or replaces a file with a file on disk. Returns false if the file doesn't exist.
+		bool addFileFromDisk(std::string_view name, const std::filesystem::path& path, FileInfo info = {});
+
+		/// Adds or replaces every file under [directory], named like [PakWriter::addDirectory] names them.
+		/// Returns false if [directory] couldn't be listed.
+		bool addDirectory(const std::filesystem::path& directory);
+
+		/// Removes a file from the package. Files which aren't in the package are ignored.
+		void removeFile(std::string_view name);
+
+		/// Returns the amount of files added or replaced.
+		usize getFileCount() const;
+
+		/// Updates the package at [path], whose package.toc metadata is [current], and writes its new
+		/// metadata to [updated]. The package stays readable with [current] until package.toc is updated
+		/// (see [updatePackageToc]), so a failed or interrupted update leaves it intact.
+		Error update(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated);
+	};
+
+	/// Rewrites the package at [path], whose package.toc metadata is [current], without the dead space left
+	/// behind by [PakUpdater]. File data is kept in the order it's in, and chunk data is copied as stored, without
+	/// being recompressed. The package's new metadata is written to [updated]. Like [PakWriter::write], the package
+	/// is written to a temporary file first.
+	PakWriter::Error compactPackage(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated);
+
+	/// Like [compactPackage], but also reorders the package's file data, so that files which are read together are
+	/// stored together. The data of the files in [fileOrder] (given by the [hashString] of their names) is laid out
+	/// first, in that order; other files follow in the order they were in. See [getTraceFileOrder] and
+	/// [getPackageGroupFileOrder] for where orders come from.
+	PakWriter::Error reorderPackage(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated, std::span<const u32> fileOrder);
+
+	/// Returns the name hashes of the files [trace] reads, in the order they're first read.
+	std::vector<u32> getTraceFileOrder(const AccessTrace& trace);
+
+	/// Gets the name hashes of the files in the package at [path], in the order its package group lists them.
+	/// Returns false if the package couldn't be read.
+	bool getPackageGroupFileOrder(const std::filesystem::path& path, const PackageMetadata& metadata, std::vector<u32>& fileOrder);
+
+	/// How much seeking replaying an access trace on a package takes. See [computeSeekReport].
+	struct SeekReport {
+		/// Chunks read, and the bytes of (stored) chunk data read.
+		u64 chunkReads;
+		u64 bytesRead;
+
+		/// Chunks which didn't start where the chunk read before them ended, and the total distance between them.
+		u64 seeks;
+		u64 seekDistance;
+	};
+
+	/// Computes how much seeking replaying [trace] on the package at [path] takes, without reading any file data.
+	/// Returns false if the package couldn't be read.
+	bool computeSeekReport(const std::filesystem::path& path, const PackageMetadata& metadata, const AccessTrace& trace, SeekReport& report);
+
+	/// Sets the entry for [packageName] in the package.toc at [tocPath] to [metadata], adding an entry if
+	/// there isn't one already. The file is created if it doesn't exist. Returns true on success.
+	bool updatePackageToc(const std::filesystem::path& tocPath, std::string_view packageName, const PackageMetadata& metadata);
+
+} // namespace jmmt::fs
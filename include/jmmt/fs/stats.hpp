@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <mco/base_types.hpp>
+
+namespace jmmt::fs {
+
+	/// A snapshot of filesystem statistics. Package filesystems keep their own statistics,
+	/// and the game filesystem keeps the totals of every package opened through it.
+	struct Stats {
+		/// The amount of buckets in [fileReadLatency]. Bucket N counts reads which took
+		/// less than 2^N nanoseconds (and at least 2^(N-1), for N > 0).
+		constexpr static usize LatencyBucketCount = 40;
+
+		/// Bytes read from package files on disk.
+		u64 bytesRead;
+
+		/// Reads and seeks done on package files on disk.
+		u64 diskReads;
+		u64 diskSeeks;
+
+		/// Package files opened with [PakFileSystem::fileOpen].
+		u64 fileOpens;
+
+		/// Chunks decoded, by whether they were compressed or not.
+		u64 compressedChunksDecoded;
+		u64 uncompressedChunksDecoded;
+
+		/// Chunks which had to be decoded again by an open file, because it seeked away from them and back.
+		u64 chunkRedecodes;
+
+		/// Chunks whose data was already read in by a read of the chunks before it,
+		/// and chunks which needed a read of their own.
+		u64 readBufferHits;
+		u64 readBufferMisses;
+
+		/// Packages whose index was loaded from an index cache, and packages whose index had to be parsed.
+		u64 indexCacheHits;
+		u64 indexCacheMisses;
+
+		/// Packages which had a decompressed image in the image cache, and packages which didn't.
+		u64 imageCacheHits;
+		u64 imageCacheMisses;
+
+		/// Chunks of a prefetch plan which were ready by the time a file needed them,
+		/// and chunks which weren't (and had to be decoded by the file itself).
+		u64 prefetchHits;
+		u64 prefetchMisses;
+
+		/// Bytes of memory held for buffers, indices and caches right now, and the most held at once.
+		/// Memory mapped caches aren't counted, since their pages belong to the OS page cache.
+		u64 memoryInUse;
+		u64 peakMemoryInUse;
+
+		/// Optional allocations (read-ahead buffers and prefetched chunks) turned down because the memory budget
+		/// was spent. See [GameFileSystem::setMemoryLimit].
+		u64 memoryBudgetDenials;
+
+		/// Total time spent decoding chunks.
+		std::chrono::nanoseconds decodeTime;
+
+		/// Calls to [PakFileSystem::fileRead], and a log2 histogram of how long they took.
+		u64 fileReads;
+		std::array<u64, LatencyBucketCount> fileReadLatency;
+
+		/// Returns the (approximate) [percentile]th percentile of fileRead() latency, where [percentile] is
+		/// between 0 and 100. The result is the upper bound of the histogram bucket the percentile falls in.
+		std::chrono::nanoseconds getFileReadLatencyPercentile(double percentile) const;
+	};
+
+} // namespace jmmt::fs
@@ -64,6 +64,10 @@ namespace jmmt::impl {
 		}
 
 		void clear() {
+			// Nothing was ever allocated.
+			if(!pBucketInfo)
+				return;
+
 			Handle handlesToClear[MaxSize];
 			u32 nHandles = 0;
 
@@ -0,0 +1,38 @@
+#pragma once
+#include <filesystem>
+#include <mco/base_types.hpp>
+#include <span>
+
+namespace jmmt::impl {
+
+	/// A read-only mapping of an entire file into memory.
+	/// On platforms without mmap(), the file is read into a heap buffer instead.
+	class MappedFile {
+		const u8* pData = nullptr;
+		usize size = 0;
+		bool heapAllocated = false;
+
+		MappedFile() = default;
+
+	   public:
+		/// Maps the file at [path]. Returns a null pointer if the file could not be opened or mapped.
+		static Unique<MappedFile> open(const std::filesystem::path& path);
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		~MappedFile();
+
+		const u8* data() const {
+			return pData;
+		}
+
+		usize getSize() const {
+			return size;
+		}
+
+		std::span<const u8> getSpan() const {
+			return { pData, size };
+		}
+	};
+
+} // namespace jmmt::impl
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mco/base_types.hpp>
+#include <thread>
+#include <vector>
+
+namespace jmmt::impl {
+
+	/// Returns the amount of worker threads to use for [nThreads], where 0 means
+	/// one worker per hardware thread.
+	inline u32 getWorkerCount(u32 nThreads) {
+		if(nThreads == 0)
+			nThreads = std::max(1u, std::thread::hardware_concurrency());
+		return nThreads;
+	}
+
+	/// Calls [f] with every index in [0, count) on a pool of [nThreads] worker threads
+	/// (see [getWorkerCount]). Indices are handed out one at a time, so uneven work
+	/// balances itself out. Returns once every index has been processed. If [f] throws, the remaining
+	/// indices are skipped, and the first exception is rethrown once every worker has finished.
+	template <class F>
+	void parallelFor(usize count, u32 nThreads, F&& f) {
+		auto nWorkers = std::min<usize>(getWorkerCount(nThreads), count);
+
+		// Don't bother spinning up threads if there's only going to be one.
+		if(nWorkers <= 1) {
+			for(usize i = 0; i < count; ++i)
+				f(i);
+			return;
+		}
+
+		std::atomic<usize> nextIndex = 0;
+		std::exception_ptr firstException;
+		std::atomic_flag hasException;
+		auto worker = [&]() {
+			try {
+				for(auto i = nextIndex.fetch_add(1, std::memory_order_relaxed); i < count; i = nextIndex.fetch_add(1, std::memory_order_relaxed))
+					f(i);
+			} catch(...) {
+				// An exception escaping a thread would terminate the process, so it's handed back to the caller.
+				// Moving past the end stops the other workers from taking more indices.
+				if(!hasException.test_and_set())
+					firstException = std::current_exception();
+				nextIndex.store(count, std::memory_order_relaxed);
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(nWorkers - 1);
+		for(usize i = 0; i < nWorkers - 1; ++i)
+			workers.emplace_back(worker);
+
+		// The calling thread does work too.
+		worker();
+
+		for(auto& thread : workers)
+			thread.join();
+
+		if(firstException)
+			std::rethrow_exception(firstException);
+	}
+
+} // namespace jmmt::impl
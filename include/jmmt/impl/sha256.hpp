@@ -1,7 +1,10 @@
 #pragma once
 #include <array>
+#include <filesystem>
 #include <mco/base_types.hpp>
 #include <mco/io/stream.hpp>
+#include <optional>
+#include <span>
 
 namespace jmmt::impl {
 	/// The resulting bytes of a SHA-256 digest.
@@ -12,4 +15,13 @@ namespace jmmt::impl {
 
 	/// Performs a SHA-256 digest on a mcolib stream.
 	ShaDigest sha256Digest(mco::Stream& stream);
+
+	/// Performs a SHA-256 digest on the file at [path], which is mapped rather than read where possible.
+	/// Returns an empty optional if the file couldn't be opened.
+	std::optional<ShaDigest> sha256Digest(const std::filesystem::path& path);
+
+	/// Performs a SHA-256 digest of every buffer in [buffers], writing the digest of each to the same
+	/// index in [digests] (which must be at least as large). Where the CPU allows it, several buffers are
+	/// hashed at once, so this is faster than hashing them one by one.
+	void sha256Digests(std::span<const std::span<const u8>> buffers, std::span<ShaDigest> digests);
 } // namespace jmmt::impl
@@ -0,0 +1,16 @@
+#pragma once
+#include <mco/base_types.hpp>
+
+namespace jmmt::lzss {
+
+	/// Returns the largest size [compress] can produce for [inputLength] bytes of input.
+	/// (Every byte being a literal, plus one flag byte per 8 literals.)
+	constexpr i32 getMaxCompressedSize(i32 inputLength) {
+		return inputLength + (inputLength + 7) / 8;
+	}
+
+	/// Compress input into the 3DO LZSS format [decompress] reads. Returns the compressed size,
+	/// or -1 if the compressed data would not fit in [outputCapacity] bytes.
+	i32 compress(const u8* input, i32 inputLength, u8* output, i32 outputCapacity);
+
+} // namespace jmmt::lzss
@@ -0,0 +1,65 @@
+//! Generator for synthetic game filesystems.
+//!
+//! Synthetic filesystems have the same layout as a real disc dump (a DATA folder with package.toc and
+//! .pak files, and IRX, MOVIES and MUSIC folders), but with made-up, deterministic contents. They let
+//! tests and benchmarks exercise libjmmt without a copy of the game. Since there is no game ELF, they
+//! have to be opened with [createGameFileSystem(path, assumedVersion)].
+#pragma once
+#include <filesystem>
+#include <jmmt/fs/package_metadata.hpp>
+#include <jmmt/game_version.hpp>
+#include <mco/base_types.hpp>
+#include <string>
+#include <vector>
+
+namespace jmmt::synth {
+
+	/// The version synthetic filesystems should be opened as.
+	constexpr static auto SyntheticGameVersion = GameVersion::NtscU_Release;
+
+	/// Describes one synthetic package.
+	struct PackageOptions {
+		/// The name of the package, as listed in package.toc.
+		std::string name;
+
+		/// The amount of files in the package.
+		u32 fileCount = 100;
+
+		/// File sizes are picked uniformly between these (inclusive).
+		u32 minFileSize = 0;
+		u32 maxFileSize = 256 * 1024;
+
+		/// How compressible file data is, from 0 (random bytes) to 1 (long runs of repeated data).
+		/// Chunks which don't get smaller when compressed are stored uncompressed, like the game's tools do.
+		float compressibility = 0.5f;
+
+		/// Extra, unreferenced strings added to the string table, to grow it without adding files.
+		u32 extraStrings = 0;
+
+		/// Seed of the random generator used for this package's sizes and data.
+		u32 seed = 0;
+	};
+
+	/// Describes a synthetic game filesystem.
+	struct GameOptions {
+		std::vector<PackageOptions> packages;
+	};
+
+	/// Returns the name of file [fileIndex] in a synthetic package.
+	std::string getFileName(const PackageOptions& package, u32 fileIndex);
+
+	/// Returns the size of file [fileIndex] in a synthetic package.
+	u32 getFileSize(const PackageOptions& package, u32 fileIndex);
+
+	/// Returns the data of file [fileIndex] in a synthetic package.
+	std::vector<u8> getFileData(const PackageOptions& package, u32 fileIndex);
+
+	/// Writes a synthetic package to [path], and its package.toc metadata to [metadata].
+	/// Returns true on success.
+	bool writePackage(const std::filesystem::path& path, const PackageOptions& package, fs::PackageMetadata& metadata);
+
+	/// Writes a synthetic game filesystem rooted at [root]. The folder is created if needed;
+	/// files already in it are overwritten. Returns true on success.
+	bool generateGameFileSystem(const std::filesystem::path& root, const GameOptions& options);
+
+} // namespace jmmt::synth
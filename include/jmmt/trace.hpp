@@ -0,0 +1,51 @@
+#pragma once
+#include <mco/base_types.hpp>
+
+// Tracing of libjmmt's hot paths to a Chrome trace (which Perfetto can also load). Users of libjmmt
+// can record their own spans with JMMT_TRACE_SCOPE too, which then show up alongside libjmmt's.
+//
+// Tracing is only compiled in when JMMT_ENABLE_TRACING is defined (the CMake option of the same name);
+// otherwise the macros below expand to nothing. When it is compiled in, spans are only recorded if the
+// JMMT_TRACE environment variable is set, and written as JSON to the path in it when the process exits.
+
+#ifdef JMMT_ENABLE_TRACING
+	#include <chrono>
+
+namespace jmmt::impl {
+
+	/// Returns true if spans are being recorded (JMMT_TRACE is set).
+	bool traceEnabled();
+
+	/// Records a span named [pName] on the calling thread. [pName] must have static storage duration.
+	void traceRecordSpan(const char* pName, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	/// Records a span covering this object's lifetime.
+	class TraceScope {
+		const char* pName;
+		std::chrono::steady_clock::time_point start;
+
+	   public:
+		explicit TraceScope(const char* pName)
+			: pName(traceEnabled() ? pName : nullptr) {
+			if(this->pName)
+				start = std::chrono::steady_clock::now();
+		}
+
+		TraceScope(const TraceScope&) = delete;
+
+		~TraceScope() {
+			if(pName)
+				traceRecordSpan(pName, start, std::chrono::steady_clock::now());
+		}
+	};
+
+} // namespace jmmt::impl
+
+	#define JMMT_TRACE_CONCAT_IMPL(a, b) a##b
+	#define JMMT_TRACE_CONCAT(a, b) JMMT_TRACE_CONCAT_IMPL(a, b)
+
+	/// Records a span named [name] (a string literal) from here until the end of the enclosing scope.
+	#define JMMT_TRACE_SCOPE(name) ::jmmt::impl::TraceScope JMMT_TRACE_CONCAT(jmmtTraceScope, __LINE__)(name)
+#else
+	#define JMMT_TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,103 @@
+// Scaling benchmark of the game and package filesystems, on synthetic filesystems of 10, 10k and 1M files.
+// Other file counts can be given on the command line.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <jmmt/fs/game_filesystem.hpp>
+#include <jmmt/synth/game_generator.hpp>
+#include <vector>
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	double msSince(Clock::time_point start) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	bool runBenchmark(u32 fileCount) {
+		auto root = std::filesystem::temp_directory_path() / std::format("jmmt_game_fs_bench_{}", fileCount);
+
+		// Keep files small, so that the larger file counts measure indexing rather than disk bandwidth.
+		jmmt::synth::PackageOptions package {
+			.name = "BENCH.PAK",
+			.fileCount = fileCount,
+			.minFileSize = 0,
+			.maxFileSize = fileCount > 10000 ? 512 : (fileCount > 100 ? 16 * 1024 : 128 * 1024),
+			.compressibility = 0.5f,
+			.seed = 1
+		};
+
+		auto start = Clock::now();
+		if(!jmmt::synth::generateGameFileSystem(root, { .packages = { package } })) {
+			std::printf("generating a synthetic filesystem in \"%s\" failed\n", root.string().c_str());
+			return false;
+		}
+		std::printf("%u files: generate %.3f ms\n", fileCount, msSince(start));
+
+		start = Clock::now();
+		auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+		if(!fs) {
+			std::printf("opening the synthetic filesystem failed\n");
+			return false;
+		}
+		std::printf("%u files: game filesystem init %.3f ms\n", fileCount, msSince(start));
+
+		for(auto mode : { jmmt::fs::PakFileSystem::InitEager, jmmt::fs::PakFileSystem::InitLazy }) {
+			auto pak = fs->openPackageFile(package.name, mode);
+			if(!pak) {
+				std::printf("opening the synthetic package failed\n");
+				return false;
+			}
+
+			std::printf("%u files: %s package init %.3f ms\n", fileCount, mode == jmmt::fs::PakFileSystem::InitEager ? "eager" : "lazy",
+						std::chrono::duration<double, std::milli>(pak->getInitializationTime()).count());
+
+			// Lazy packages only pay for lookups as files are used, so time one.
+			if(mode == jmmt::fs::PakFileSystem::InitLazy) {
+				start = Clock::now();
+				auto handle = pak->fileOpen(jmmt::synth::getFileName(package, fileCount / 2));
+				pak->fileClose(handle);
+				std::printf("%u files: lazy package first open %.3f ms\n", fileCount, msSince(start));
+				continue;
+			}
+
+			start = Clock::now();
+			u64 nFiles = 0;
+			for(auto file : pak->enumerateFiles(jmmt::fs::PakFileSystem::SortByName))
+				nFiles += file.name.empty() ? 0 : 1;
+			std::printf("%u files: enumerate by name %.3f ms (%llu files)\n", fileCount, msSince(start), static_cast<unsigned long long>(nFiles));
+
+			// Read every file, in data order.
+			start = Clock::now();
+			std::vector<u8> buffer;
+			u64 bytesRead = 0;
+			for(auto file : pak->enumerateFiles(jmmt::fs::PakFileSystem::SortByOffset)) {
+				buffer.resize(file.metadata.fileSize);
+				auto handle = pak->fileOpen(file.name);
+				bytesRead += pak->fileRead(handle, buffer.data(), file.metadata.fileSize);
+				pak->fileClose(handle);
+			}
+			auto ms = msSince(start);
+			std::printf("%u files: read all %.3f ms (%.1f MB/s)\n", fileCount, ms, (bytesRead / (1024.0 * 1024.0)) / (ms / 1000.0));
+		}
+
+		std::filesystem::remove_all(root);
+		return true;
+	}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	std::vector<u32> fileCounts;
+	for(int i = 1; i < argc; ++i)
+		fileCounts.push_back(std::strtoul(argv[i], nullptr, 0));
+	if(fileCounts.empty())
+		fileCounts = { 10, 10000, 1000000 };
+
+	for(auto fileCount : fileCounts)
+		if(!runBenchmark(fileCount))
+			return 1;
+	return 0;
+}
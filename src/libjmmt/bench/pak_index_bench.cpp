@@ -0,0 +1,129 @@
+// Micro-benchmark of package initialization on a synthetic header block.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <jmmt/crc.hpp>
+#include <libjmmt/fs/pak_index.hpp>
+#include <vector>
+
+namespace {
+
+	constexpr u32 FileCount = 50000;
+	constexpr u32 Iterations = 10;
+
+	struct SyntheticPackage {
+		std::vector<u8> headerBlock;
+		std::vector<std::string> stringTable;
+	};
+
+	/// Builds a header block with [FileCount] files of 1-3 chunks each,
+	/// laid out the same way as the game's packages.
+	SyntheticPackage makeSyntheticPackage() {
+		SyntheticPackage package;
+
+		const char* typeNames[] = { "Texture", "Model", "Sound", "Script" };
+		for(auto* typeName : typeNames)
+			package.stringTable.push_back(typeName);
+
+		auto appendRecord = [&](const auto& record) {
+			auto* pBytes = reinterpret_cast<const u8*>(&record);
+			package.headerBlock.insert(package.headerBlock.end(), pBytes, pBytes + sizeof(record));
+		};
+
+		jmmt::structs::PackageGroupHeader group {
+			.magic = jmmt::structs::PackageGroupHeader::MAGIC,
+			.indexName = jmmt::hashString("bench"),
+			.nEntries = FileCount,
+			.flagsMask = 0
+		};
+		appendRecord(group);
+
+		u32 dataOffset = 0;
+		for(u32 i = 0; i < FileCount; ++i) {
+			auto& name = package.stringTable.emplace_back(std::format("bench\\file{:05}.bin", i));
+			auto& sourceName = package.stringTable.emplace_back(std::format("c:\\jmmt\\source\\file{:05}.src", i));
+			auto nameHash = jmmt::hashString(name);
+			auto sourceNameHash = jmmt::hashString(sourceName);
+			auto typeHash = jmmt::hashString(typeNames[i % 4]);
+
+			i16 chunkCount = static_cast<i16>((i % 3) + 1);
+			for(i16 chunk = 0; chunk < chunkCount; ++chunk) {
+				jmmt::structs::PackageFileHeader pfil {};
+				pfil.magic = jmmt::structs::PackageFileHeader::MAGIC;
+				pfil.chunkNumber = chunk;
+				pfil.chunkCount = chunkCount;
+				pfil.indexName = nameHash;
+				pfil.indexSourceName = sourceNameHash;
+				pfil.indexSourceConvertName = sourceNameHash;
+				pfil.indexSourceCompressName = sourceNameHash;
+				pfil.indexType = typeHash;
+				pfil.chunkSize = 65536;
+				pfil.chunkOffset = chunk * 65536;
+				pfil.dataSize = 32768;
+				pfil.dataOffset = dataOffset;
+				pfil.totalFileSize = chunkCount * 65536;
+				appendRecord(pfil);
+				dataOffset += pfil.dataSize;
+			}
+		}
+
+		return package;
+	}
+
+} // namespace
+
+int main() {
+	auto package = makeSyntheticPackage();
+	std::printf("synthetic package: %u files, %zu header bytes, %zu strings\n", FileCount, package.headerBlock.size(), package.stringTable.size());
+
+	// Copy the header block into a buffer allocated like the package filesystem's.
+	auto headerBuffer = std::make_unique<u8[]>(package.headerBlock.size());
+	std::memcpy(headerBuffer.get(), package.headerBlock.data(), package.headerBlock.size());
+
+	double best = 0.0;
+	double total = 0.0;
+	for(u32 i = 0; i < Iterations; ++i) {
+		auto stringTable = package.stringTable;
+
+		auto start = std::chrono::steady_clock::now();
+		jmmt::fs::PakIndex index;
+		index.setStringTable(std::move(stringTable));
+		if(!index.processChunks({ headerBuffer.get(), package.headerBlock.size() })) {
+			std::printf("processing synthetic header block failed\n");
+			return 1;
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		auto ms = std::chrono::duration<double, std::milli>(end - start).count();
+		if(i == 0 || ms < best)
+			best = ms;
+		total += ms;
+	}
+
+	std::printf("package init: best %.3f ms, mean %.3f ms (%.1f ns/file)\n", best, total / Iterations, (best * 1e6) / FileCount);
+
+	// Lazily initialize the same package, and look up a single file in it.
+	best = 0.0;
+	total = 0.0;
+	for(u32 i = 0; i < Iterations; ++i) {
+		auto lazyHeaderBuffer = std::make_unique<u8[]>(package.headerBlock.size());
+		std::memcpy(lazyHeaderBuffer.get(), package.headerBlock.data(), package.headerBlock.size());
+
+		auto start = std::chrono::steady_clock::now();
+		jmmt::fs::PakIndex index;
+		if(!index.processChunksLazy(std::move(lazyHeaderBuffer), package.headerBlock.size()) || !index.findFile("bench\\file12345.bin")) {
+			std::printf("lazily processing synthetic header block failed\n");
+			return 1;
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		auto ms = std::chrono::duration<double, std::milli>(end - start).count();
+		if(i == 0 || ms < best)
+			best = ms;
+		total += ms;
+	}
+
+	std::printf("lazy package init + 1 lookup: best %.3f ms, mean %.3f ms\n", best, total / Iterations);
+	return 0;
+}
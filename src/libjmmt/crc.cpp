@@ -1,9 +1,19 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
 #include <jmmt/crc.hpp>
+#include <span>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define JMMT_CRC_CLMUL
+	#include <immintrin.h>
+#endif
 
 namespace jmmt {
 
 	/// Standard Ethernet-II CRC32 polynominal table.
-	constinit static u32 Crc32Table[] = {
+	constexpr static u32 Crc32Table[] = {
 		0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
 		0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
 		0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
@@ -49,20 +59,205 @@ namespace jmmt {
 		0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 	};
 
-	Crc32Result hashString(std::string_view str) {
-		u32 crc = 0;
-		for(char c : str) {
-			crc = Crc32Table[(crc ^ (c & ~0x20)) & 0xff] ^ (crc >> 8);
+	namespace {
+
+		/// Slicing-by-8 tables. Table 0 is [Crc32Table]; table N advances a byte's CRC through N more zero bytes,
+		/// so that eight bytes can be folded into the CRC with eight independent lookups.
+		constexpr auto Crc32SlicingTables = []() {
+			std::array<std::array<u32, 256>, 8> tables {};
+			for(u32 i = 0; i < 256; ++i)
+				tables[0][i] = Crc32Table[i];
+			for(u32 i = 0; i < 256; ++i)
+				for(u32 table = 1; table < 8; ++table)
+					tables[table][i] = (tables[table - 1][i] >> 8) ^ tables[0][tables[table - 1][i] & 0xff];
+			return tables;
+		}();
+
+		/// The game's case folding: bit 5 of every byte is cleared (which makes ASCII letters upper case,
+		/// and also changes some non-letters, but that's what the game does).
+		constexpr u8 CaseFoldMask = static_cast<u8>(~0x20);
+		constexpr u64 CaseFoldMask64 = 0xdfdfdfdfdfdfdfdf;
+
+		template <bool FoldCase>
+		inline u32 updateByte(u32 crc, u8 byte) {
+			if constexpr(FoldCase)
+				byte &= CaseFoldMask;
+			return Crc32Table[(crc ^ byte) & 0xff] ^ (crc >> 8);
 		}
-		return crc;
-	}
 
+		template <bool FoldCase>
+		u32 updateBytes(u32 crc, const u8* pData, usize length) {
+			for(usize i = 0; i < length; ++i)
+				crc = updateByte<FoldCase>(crc, pData[i]);
+			return crc;
+		}
+
+		/// Folds the eight bytes at [pData] into [crc] (see [updateSlicing8]).
+		template <bool FoldCase>
+		inline u32 updateWord(u32 crc, const u8* pData) {
+			auto& t = Crc32SlicingTables;
+			u64 word;
+			std::memcpy(&word, pData, sizeof(word));
+			if constexpr(FoldCase)
+				word &= CaseFoldMask64;
+			word ^= crc;
+
+			return t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^ t[4][(word >> 24) & 0xff] ^
+				   t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^ t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+		}
+
+		/// Slicing-by-8. Eight bytes are case folded at once with a single mask.
+		template <bool FoldCase>
+		u32 updateSlicing8(u32 crc, const u8* pData, usize length) {
+			if constexpr(std::endian::native != std::endian::little)
+				return updateBytes<FoldCase>(crc, pData, length);
+
+			for(; length >= 8; pData += 8, length -= 8)
+				crc = updateWord<FoldCase>(crc, pData);
+			return updateBytes<FoldCase>(crc, pData, length);
+		}
+
+#ifdef JMMT_CRC_CLMUL
+		/// The smallest input the carry-less multiply path is used for. Below this, its setup and
+		/// final reduction cost more than slicing does.
+		constexpr usize ClmulMinLength = 256;
+
+		/// CRC folding with carry-less multiplication (see Intel's "Fast CRC Computation for Generic Polynomials
+		/// Using PCLMULQDQ Instruction"), with the bit-reflected constants for the CRC-32 polynomial. Consumes
+		/// [length] rounded down to 16 bytes; [length] must be at least 64. The case fold is done 16 bytes at a time.
+		#define JMMT_CRC_CLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+
+		template <bool FoldCase>
+		JMMT_CRC_CLMUL_TARGET inline __m128i loadClmul(const u8* pData) {
+			auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData));
+			if constexpr(FoldCase)
+				block = _mm_and_si128(block, _mm_set1_epi8(static_cast<char>(CaseFoldMask)));
+			return block;
+		}
+
+		/// Folds [x] forward by the distance [k] is the constants for, and adds in [next].
+		JMMT_CRC_CLMUL_TARGET inline __m128i foldClmul(__m128i x, __m128i k, __m128i next) {
+			auto lo = _mm_clmulepi64_si128(x, k, 0x00);
+			auto hi = _mm_clmulepi64_si128(x, k, 0x11);
+			return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+		}
+
+		template <bool FoldCase>
+		JMMT_CRC_CLMUL_TARGET u32 updateClmul(u32 crc, const u8* pData, usize length) {
+			alignas(16) static constexpr u64 k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+			alignas(16) static constexpr u64 k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+			alignas(16) static constexpr u64 k5k0[] = { 0x0163cd6124, 0x0000000000 };
+			alignas(16) static constexpr u64 poly[] = { 0x01db710641, 0x01f7011641 };
+
+			// Fold four blocks in parallel while there are 64 bytes left.
+			auto x1 = _mm_xor_si128(loadClmul<FoldCase>(pData), _mm_cvtsi32_si128(static_cast<int>(crc)));
+			auto x2 = loadClmul<FoldCase>(pData + 16);
+			auto x3 = loadClmul<FoldCase>(pData + 32);
+			auto x4 = loadClmul<FoldCase>(pData + 48);
+			pData += 64;
+			length -= 64;
+
+			auto k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+			for(; length >= 64; pData += 64, length -= 64) {
+				x1 = foldClmul(x1, k, loadClmul<FoldCase>(pData));
+				x2 = foldClmul(x2, k, loadClmul<FoldCase>(pData + 16));
+				x3 = foldClmul(x3, k, loadClmul<FoldCase>(pData + 32));
+				x4 = foldClmul(x4, k, loadClmul<FoldCase>(pData + 48));
+			}
 
-	Crc32Result hashStringCase(std::string_view str) {
-		u32 crc = 0;
-		for(char c : str) {
-			crc = Crc32Table[(crc ^ (c)) & 0xff] ^ (crc >> 8);
+			// Fold the four blocks into one, and then fold in the remaining whole blocks.
+			k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+			x1 = foldClmul(x1, k, x2);
+			x1 = foldClmul(x1, k, x3);
+			x1 = foldClmul(x1, k, x4);
+			for(; length >= 16; pData += 16, length -= 16)
+				x1 = foldClmul(x1, k, loadClmul<FoldCase>(pData));
+
+			// Fold 128 bits down to 64.
+			auto lowMask = _mm_setr_epi32(~0, 0, ~0, 0);
+			x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+			k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, lowMask), k, 0x00), x2);
+
+			// Barrett reduction down to 32 bits.
+			k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, lowMask), k, 0x10);
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, lowMask), k, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+			return static_cast<u32>(_mm_extract_epi32(x1, 1));
 		}
-		return crc;
+
+		bool hasClmul() {
+			static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+			return supported;
+		}
+#endif
+
+		template <bool FoldCase>
+		u32 update(u32 crc, const u8* pData, usize length) {
+#ifdef JMMT_CRC_CLMUL
+			if(length >= ClmulMinLength && hasClmul()) {
+				auto clmulLength = length & ~usize(15);
+				crc = updateClmul<FoldCase>(crc, pData, clmulLength);
+				pData += clmulLength;
+				length -= clmulLength;
+			}
+#endif
+			return updateSlicing8<FoldCase>(crc, pData, length);
+		}
+
+		/// Hashes strings four at a time. The four CRCs don't depend on each other, so interleaving them
+		/// keeps the table lookups of all four in flight at once, instead of each string waiting on its
+		/// own chain of lookups.
+		template <bool FoldCase>
+		void updateBatch(std::span<const std::string_view> strings, std::span<Crc32Result> hashes) {
+			usize i = 0;
+			if constexpr(std::endian::native == std::endian::little) {
+				for(; i + 4 <= strings.size(); i += 4) {
+					const u8* pData[4];
+					u32 crc[4] {};
+					usize common = strings[i].size();
+					for(usize j = 0; j < 4; ++j) {
+						pData[j] = reinterpret_cast<const u8*>(strings[i + j].data());
+						common = std::min(common, strings[i + j].size());
+					}
+
+					usize offset = 0;
+					for(; offset + 8 <= common; offset += 8) {
+						crc[0] = updateWord<FoldCase>(crc[0], pData[0] + offset);
+						crc[1] = updateWord<FoldCase>(crc[1], pData[1] + offset);
+						crc[2] = updateWord<FoldCase>(crc[2], pData[2] + offset);
+						crc[3] = updateWord<FoldCase>(crc[3], pData[3] + offset);
+					}
+
+					for(usize j = 0; j < 4; ++j)
+						hashes[i + j] = update<FoldCase>(crc[j], pData[j] + offset, strings[i + j].size() - offset);
+				}
+			}
+
+			for(; i < strings.size(); ++i)
+				hashes[i] = update<FoldCase>(0, reinterpret_cast<const u8*>(strings[i].data()), strings[i].size());
+		}
+
+	} // namespace
+
+	Crc32Result impl::hashStringRuntime(std::string_view str) {
+		return update<true>(0, reinterpret_cast<const u8*>(str.data()), str.size());
+	}
+
+	Crc32Result impl::hashStringCaseRuntime(std::string_view str) {
+		return update<false>(0, reinterpret_cast<const u8*>(str.data()), str.size());
 	}
-}
+
+	void hashStrings(std::span<const std::string_view> strings, std::span<Crc32Result> hashes) {
+		updateBatch<true>(strings, hashes);
+	}
+
+	void hashStringsCase(std::span<const std::string_view> strings, std::span<Crc32Result> hashes) {
+		updateBatch<false>(strings, hashes);
+	}
+
+} // namespace jmmt
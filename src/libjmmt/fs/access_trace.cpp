@@ -0,0 +1,86 @@
+#include <charconv>
+#include <format>
+#include <jmmt/fs/access_trace.hpp>
+#include <mco/io/file_stream.hpp>
+#include <string_view>
+
+namespace jmmt::fs {
+
+	namespace {
+		/// The first line of a saved trace. Each line after it is "timestamp offset length name",
+		/// with the timestamp in nanoseconds. The name goes last, since it's the only field that can have spaces.
+		constexpr std::string_view TraceHeader = "# jmmt access trace v1";
+
+		/// Parses the number at the start of [line], and removes it (and the space after it) from [line].
+		template <class T>
+		bool parseField(std::string_view& line, T& value) {
+			auto [pEnd, ec] = std::from_chars(line.data(), line.data() + line.size(), value);
+			if(ec != std::errc() || pEnd == line.data() + line.size() || *pEnd != ' ')
+				return false;
+			line.remove_prefix(pEnd - line.data() + 1);
+			return true;
+		}
+	} // namespace
+
+	bool AccessTrace::save(const std::filesystem::path& path) const {
+		std::string text(TraceHeader);
+		text += '\n';
+		for(auto& entry : entries)
+			text += std::format("{} {} {} {}\n", entry.timestamp.count(), entry.offset, entry.length, entry.fileName);
+
+		try {
+			std::error_code ec;
+			std::filesystem::remove(path, ec);
+
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str(), mco::FileStream::ReadWrite | mco::FileStream::Create);
+			return stream.write(text.data(), text.size()) == text.size();
+		} catch(std::system_error& err) {
+			return false;
+		}
+	}
+
+	std::optional<AccessTrace> AccessTrace::load(const std::filesystem::path& path) {
+		std::string text;
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+			text.resize(stream.getSize());
+			if(stream.read(text.data(), text.size()) != text.size())
+				return std::nullopt;
+		} catch(std::system_error& err) {
+			return std::nullopt;
+		}
+
+		std::string_view remaining = text;
+		auto nextLine = [&]() {
+			auto end = remaining.find('\n');
+			auto line = remaining.substr(0, end);
+			remaining.remove_prefix(end == std::string_view::npos ? remaining.size() : end + 1);
+			if(line.ends_with('\r'))
+				line.remove_suffix(1);
+			return line;
+		};
+
+		if(nextLine() != TraceHeader)
+			return std::nullopt;
+
+		AccessTrace trace;
+		while(!remaining.empty()) {
+			auto line = nextLine();
+			if(line.empty())
+				continue;
+
+			AccessTraceEntry entry {};
+			i64 timestamp = 0;
+			if(!parseField(line, timestamp) || !parseField(line, entry.offset) || !parseField(line, entry.length) || line.empty())
+				return std::nullopt;
+			entry.timestamp = std::chrono::nanoseconds(timestamp);
+			entry.fileName = line;
+			trace.entries.push_back(std::move(entry));
+		}
+
+		return trace;
+	}
+
+} // namespace jmmt::fs
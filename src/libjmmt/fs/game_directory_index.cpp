@@ -0,0 +1,99 @@
+#include <charconv>
+#include <format>
+#include <jmmt/crc.hpp>
+#include <mutex>
+
+#include "game_directory_index.hpp"
+
+namespace jmmt::fs {
+
+	namespace {
+		/// Parses the name hash out of a hashed file name. Only names exactly as the game (and
+		/// [resolveGameFilePath]) would format them are accepted, so "0ABC.DAT" or "abc.DAT" aren't.
+		std::optional<u32> parseHashedName(std::string_view name) {
+			constexpr std::string_view Extension = ".DAT";
+			if(!name.ends_with(Extension))
+				return std::nullopt;
+
+			auto stem = name.substr(0, name.size() - Extension.size());
+			u32 nameHash;
+			if(auto [pEnd, ec] = std::from_chars(stem.data(), stem.data() + stem.size(), nameHash, 16); ec != std::errc {} || pEnd != stem.data() + stem.size())
+				return std::nullopt;
+
+			if(std::format("{:X}", nameHash) != stem)
+				return std::nullopt;
+			return nameHash;
+		}
+
+		bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+			if(a.size() != b.size())
+				return false;
+			for(usize i = 0; i < a.size(); ++i) {
+				auto ca = a[i] >= 'a' && a[i] <= 'z' ? a[i] - 0x20 : a[i];
+				auto cb = b[i] >= 'a' && b[i] <= 'z' ? b[i] - 0x20 : b[i];
+				if(ca != cb)
+					return false;
+			}
+			return true;
+		}
+	} // namespace
+
+	bool GameDirectoryIndex::scan(std::span<const std::filesystem::path> folderPaths) {
+		// List everything before taking the lock, so resolving isn't held up by the filesystem.
+		std::vector<Folder> newFolders(folderPaths.size());
+		bool success = true;
+		for(usize i = 0; i < folderPaths.size(); ++i) {
+			auto& folder = newFolders[i];
+			folder.path = folderPaths[i];
+
+			std::error_code ec;
+			for(auto it = std::filesystem::directory_iterator(folder.path, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+				std::error_code typeEc;
+				if(!it->is_regular_file(typeEc))
+					continue;
+
+				auto name = it->path().filename().string();
+				if(auto nameHash = parseHashedName(name); nameHash)
+					folder.hashedFiles.try_emplace(*nameHash, it->path());
+				folder.clearFiles.emplace(jmmt::hashString(name), std::move(name));
+			}
+
+			folder.scanned = !ec;
+			if(ec) {
+				folder.hashedFiles.clear();
+				folder.clearFiles.clear();
+				success = false;
+			}
+		}
+
+		std::unique_lock lock(mutex);
+		folders = std::move(newFolders);
+		return success;
+	}
+
+	std::optional<std::filesystem::path> GameDirectoryIndex::resolve(usize folderIndex, std::string_view filename, u32 nameHash, bool hashedNames) const {
+		std::shared_lock lock(mutex);
+		if(folderIndex >= folders.size() || !folders[folderIndex].scanned)
+			return std::nullopt;
+
+		auto& folder = folders[folderIndex];
+		if(hashedNames) {
+			if(auto it = folder.hashedFiles.find(nameHash); it != folder.hashedFiles.end())
+				return it->second;
+		}
+
+		const std::string* pMatch = nullptr;
+		auto [begin, end] = folder.clearFiles.equal_range(nameHash);
+		for(auto it = begin; it != end; ++it) {
+			if(it->second == filename)
+				return folder.path / it->second;
+			if(!pMatch && equalsIgnoreCase(it->second, filename))
+				pMatch = &it->second;
+		}
+
+		if(pMatch)
+			return folder.path / *pMatch;
+		return folder.path / filename;
+	}
+
+} // namespace jmmt::fs
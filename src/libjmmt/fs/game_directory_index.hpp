@@ -0,0 +1,50 @@
+//! Index of the game's folders. This is an implementation detail of the game filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <filesystem>
+#include <mco/base_types.hpp>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// Lists the files in each of the game's folders (DATA, IRX, ...) once, so that resolving a game file
+	/// is a hash lookup instead of a probe of the filesystem per possible name. Folders are only listed when
+	/// [scan] is called, so files added or removed since then aren't seen until the next scan.
+	/// Resolving and scanning are safe to do from any thread.
+	class GameDirectoryIndex {
+		struct Folder {
+			std::filesystem::path path;
+
+			/// Files named by their name hash ("{hash:X}.DAT"), keyed by that hash.
+			std::unordered_map<u32, std::filesystem::path> hashedFiles;
+
+			/// Files named by their clear name, keyed by the [hashString] of the name.
+			std::unordered_multimap<u32, std::string> clearFiles;
+
+			bool scanned = false;
+		};
+
+		std::vector<Folder> folders;
+		mutable std::shared_mutex mutex;
+
+	   public:
+		/// Lists every folder in [folderPaths], replacing what was listed before. Folders are referred to by their
+		/// index in [folderPaths] afterwards. Returns false if a folder couldn't be listed; resolving files in that
+		/// folder returns an empty optional until it's scanned successfully.
+		bool scan(std::span<const std::filesystem::path> folderPaths);
+
+		/// Resolves [filename] (whose [hashString] is [nameHash]) in folder [folder]. If [hashedNames] is set, a
+		/// file named by the hash is preferred over the clear named file, like the game does for data files.
+		/// Clear names are matched regardless of case, preferring an exact match. Files which aren't in the folder
+		/// resolve to the path they'd have under their clear name. Returns an empty optional if the folder hasn't
+		/// been scanned.
+		std::optional<std::filesystem::path> resolve(usize folder, std::string_view filename, u32 nameHash, bool hashedNames) const;
+	};
+
+} // namespace jmmt::fs
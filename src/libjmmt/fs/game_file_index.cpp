@@ -0,0 +1,175 @@
+#include <bit>
+#include <cstring>
+#include <jmmt/fourcc.hpp>
+#include <libjmmt/impl/replace_file.hpp>
+#include <mco/io/file_stream.hpp>
+
+#include "game_file_index.hpp"
+
+namespace jmmt::fs {
+
+	namespace {
+		/// Header of a saved game file index. This is followed by a [CachePackage] record and name for every
+		/// package, and then a [CacheFile] record for every file.
+		struct CacheHeader {
+			constexpr static auto MAGIC = FourCCGenerator<>::generate<"JMGX">();
+			constexpr static u32 VERSION = 1;
+
+			FourCC magic;
+			u32 version;
+			u32 packageCount;
+			u32 fileCount;
+		};
+
+		/// A package in a saved index, followed by its [nameLength] byte name.
+		struct CachePackage {
+			u64 pakSize;
+			i64 pakModifiedTime;
+			u32 chunkStartOffset;
+			u32 chunkDataSize;
+			u32 nrPackageFiles;
+			u32 nameLength;
+		};
+
+		struct CacheFile {
+			u32 nameHash;
+			u32 packageIndex;
+		};
+
+		/// Reads a [T] at [offset] in [data], and moves [offset] past it. Returns false if it would run past the end.
+		template <class T>
+		bool readRecord(std::span<const u8> data, usize& offset, T& value) {
+			if(offset > data.size() || data.size() - offset < sizeof(T))
+				return false;
+			std::memcpy(&value, data.data() + offset, sizeof(T));
+			offset += sizeof(T);
+			return true;
+		}
+
+		template <class T>
+		void appendRecord(std::vector<u8>& data, const T& value) {
+			auto* pValue = reinterpret_cast<const u8*>(&value);
+			data.insert(data.end(), pValue, pValue + sizeof(T));
+		}
+	} // namespace
+
+	// NameHashFilter
+
+	void NameHashFilter::build(std::span<const u32> nameHashes) {
+		auto nBits = std::bit_ceil(std::max<usize>(nameHashes.size() * BitsPerName, 64));
+		bits.assign(nBits / 64, 0);
+		bitMask = static_cast<u32>(nBits - 1);
+
+		for(auto nameHash : nameHashes) {
+			forEachProbe(nameHash, [&](u32 bit) {
+				bits[bit / 64] |= u64(1) << (bit % 64);
+			});
+		}
+	}
+
+	// GameFileIndex
+
+	void GameFileIndex::build(std::vector<GameFileIndexPackage> packages, std::span<const std::vector<u32>> fileNameHashes) {
+		this->packages = std::move(packages);
+		filePackages.clear();
+
+		std::vector<u32> allHashes;
+		for(u32 i = 0; i < fileNameHashes.size(); ++i) {
+			for(auto nameHash : fileNameHashes[i])
+				if(filePackages.try_emplace(nameHash, i).second)
+					allHashes.push_back(nameHash);
+		}
+
+		filter.build(allHashes);
+	}
+
+	const GameFileIndexPackage* GameFileIndex::findPackage(u32 nameHash) const {
+		// Most lookups for files which aren't in any package stop here, without probing the map.
+		if(!filter.mayContain(nameHash))
+			return nullptr;
+
+		if(auto it = filePackages.find(nameHash); it != filePackages.end())
+			return &packages[it->second];
+		return nullptr;
+	}
+
+	usize GameFileIndex::getMemorySize() const {
+		// Map nodes are counted as their contents plus a next pointer and the cached hash.
+		constexpr usize NodeSize = sizeof(std::pair<const u32, u32>) + 2 * sizeof(void*);
+
+		auto size = filePackages.size() * NodeSize + filePackages.bucket_count() * sizeof(void*) + filter.getMemorySize();
+		for(auto& package : packages)
+			size += sizeof(package) + package.name.capacity();
+		return size;
+	}
+
+	bool GameFileIndex::load(const std::filesystem::path& path, std::span<const GameFileIndexPackage> expectedPackages) {
+		std::vector<u8> data;
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+			data.resize(stream.getSize());
+			if(stream.read(data.data(), data.size()) != data.size())
+				return false;
+		} catch(std::system_error& err) {
+			return false;
+		}
+
+		usize offset = 0;
+		CacheHeader header {};
+		if(!readRecord(data, offset, header) || header.magic != CacheHeader::MAGIC || header.version != CacheHeader::VERSION)
+			return false;
+
+		// The index is only valid if it was built from exactly the packages there are now.
+		if(header.packageCount != expectedPackages.size())
+			return false;
+
+		for(auto& expected : expectedPackages) {
+			CachePackage package {};
+			if(!readRecord(data, offset, package) || data.size() - offset < package.nameLength)
+				return false;
+
+			auto name = std::string_view(reinterpret_cast<const char*>(data.data() + offset), package.nameLength);
+			offset += package.nameLength;
+
+			if(name != expected.name || package.pakSize != expected.pakSize || package.pakModifiedTime != expected.pakModifiedTime ||
+			   package.chunkStartOffset != expected.chunkStartOffset || package.chunkDataSize != expected.chunkDataSize ||
+			   package.nrPackageFiles != expected.nrPackageFiles)
+				return false;
+		}
+
+		std::vector<std::vector<u32>> fileNameHashes(expectedPackages.size());
+		for(u32 i = 0; i < header.fileCount; ++i) {
+			CacheFile file {};
+			if(!readRecord(data, offset, file) || file.packageIndex >= fileNameHashes.size())
+				return false;
+			fileNameHashes[file.packageIndex].push_back(file.nameHash);
+		}
+
+		build({ expectedPackages.begin(), expectedPackages.end() }, fileNameHashes);
+		return true;
+	}
+
+	bool GameFileIndex::save(const std::filesystem::path& path) const {
+		std::vector<u8> data;
+		appendRecord(data, CacheHeader { .magic = CacheHeader::MAGIC, .version = CacheHeader::VERSION, .packageCount = static_cast<u32>(packages.size()), .fileCount = static_cast<u32>(filePackages.size()) });
+
+		for(auto& package : packages) {
+			appendRecord(data, CachePackage { .pakSize = package.pakSize,
+											  .pakModifiedTime = package.pakModifiedTime,
+											  .chunkStartOffset = package.chunkStartOffset,
+											  .chunkDataSize = package.chunkDataSize,
+											  .nrPackageFiles = package.nrPackageFiles,
+											  .nameLength = static_cast<u32>(package.name.size()) });
+			data.insert(data.end(), package.name.begin(), package.name.end());
+		}
+
+		for(auto& [nameHash, packageIndex] : filePackages)
+			appendRecord(data, CacheFile { .nameHash = nameHash, .packageIndex = packageIndex });
+
+		return impl::writeFileReplacing(path, [&](mco::FileStream& stream) {
+			return stream.write(data.data(), data.size()) == data.size();
+		});
+	}
+
+} // namespace jmmt::fs
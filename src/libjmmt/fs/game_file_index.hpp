@@ -0,0 +1,107 @@
+//! Game-wide file index. This is an implementation detail of the game filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <filesystem>
+#include <mco/base_types.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// Identifies the exact package file a [GameFileIndex] was built from.
+	/// A cached index is only used if every package still matches.
+	struct GameFileIndexPackage {
+		std::string name;
+
+		u64 pakSize;
+		i64 pakModifiedTime;
+
+		// The package.toc entry of the package.
+		u32 chunkStartOffset;
+		u32 chunkDataSize;
+		u32 nrPackageFiles;
+
+		bool operator==(const GameFileIndexPackage&) const = default;
+	};
+
+	/// A Bloom filter over file name hashes. Since names are already hashed (with [hashString]), the filter's
+	/// probes are derived from the name hash, rather than hashing names again.
+	class NameHashFilter {
+		std::vector<u64> bits;
+		u32 bitMask = 0;
+
+		/// The amount of bits set per name. With [BitsPerName] bits per name this gives about a 2% false positive rate.
+		constexpr static u32 ProbeCount = 4;
+		constexpr static u32 BitsPerName = 10;
+
+		template <class F>
+		void forEachProbe(u32 nameHash, F&& f) const {
+			// Double hashing; the second hash is made odd so every probe lands on a different bit.
+			auto secondHash = ((nameHash * 0x9e3779b1u) >> 15 | 1);
+			for(u32 i = 0; i < ProbeCount; ++i)
+				f((nameHash + i * secondHash) & bitMask);
+		}
+
+	   public:
+		/// Returns the bytes of memory the filter holds.
+		usize getMemorySize() const {
+			return bits.capacity() * sizeof(u64);
+		}
+
+		/// Builds the filter for [nameHashes].
+		void build(std::span<const u32> nameHashes);
+
+		/// Returns false if [nameHash] definitely isn't in the filter.
+		bool mayContain(u32 nameHash) const {
+			if(bits.empty())
+				return false;
+
+			bool found = true;
+			forEachProbe(nameHash, [&](u32 bit) {
+				found &= (bits[bit / 64] >> (bit % 64)) & 1;
+			});
+			return found;
+		}
+	};
+
+	/// Maps the name hash of every file in the game's packages to the package holding it.
+	class GameFileIndex {
+		std::vector<GameFileIndexPackage> packages;
+
+		/// The package index of every file, keyed by name hash.
+		std::unordered_map<u32, u32> filePackages;
+
+		NameHashFilter filter;
+
+	   public:
+		/// Builds the index from the name hashes of the files of every package; [fileNameHashes] is parallel
+		/// to [packages]. If the same name is in more than one package, the first package wins.
+		void build(std::vector<GameFileIndexPackage> packages, std::span<const std::vector<u32>> fileNameHashes);
+
+		/// Returns the package holding the file named by [nameHash], or a null pointer if no package does.
+		const GameFileIndexPackage* findPackage(u32 nameHash) const;
+
+		/// Returns the packages the index was built from.
+		std::span<const GameFileIndexPackage> getPackages() const {
+			return packages;
+		}
+
+		/// Returns the amount of files indexed.
+		usize getFileCount() const {
+			return filePackages.size();
+		}
+
+		/// Returns (roughly) the bytes of memory the index holds.
+		usize getMemorySize() const;
+
+		/// Loads an index saved by [save]. Returns false (leaving the index empty) if the file is malformed, or
+		/// was built from packages other than [packages].
+		bool load(const std::filesystem::path& path, std::span<const GameFileIndexPackage> packages);
+
+		/// Saves the index to [path]. The file is written to a temporary file first.
+		bool save(const std::filesystem::path& path) const;
+	};
+
+} // namespace jmmt::fs
@@ -1,12 +1,22 @@
 #include <filesystem>
 #include <jmmt/crc.hpp>
 #include <jmmt/fs/game_filesystem.hpp>
+#include <jmmt/impl/parallel_for.hpp>
 #include <jmmt/impl/sha256.hpp>
-#include <jmmt/structs/package_toc.hpp>
+#include <jmmt/trace.hpp>
 #include <mco/io/file_stream.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "jmmt/fs/pak_filesystem.hpp"
+#include "game_directory_index.hpp"
+#include "game_file_index.hpp"
+#include "game_version_cache.hpp"
 #include "jmmt/game_version.hpp"
+#include "memory_budget.hpp"
+#include "stats_counters.hpp"
 
 namespace jmmt::fs {
 
@@ -25,29 +35,29 @@ namespace jmmt::fs {
 		}
 	}
 
-	mco::FileStream openGameFile(const std::filesystem::path& root, const std::string_view filename, GameFileSystem::FileType type) {
+	/// Resolves a game file by probing the filesystem, given the [hashString] of its name up front. This is only used
+	/// if the game's folders couldn't be listed (see [GameDirectoryIndex]).
+	std::filesystem::path resolveGameFilePath(const std::filesystem::path& root, const std::string_view filename, Crc32Result nameHash, GameFileSystem::FileType type) {
 		auto folderPath = root / getTypeFolderName(type);
 
 		if(type == GameFileSystem::FileData) {
-			auto datFilename = std::format("{:X}.DAT", jmmt::hashString(filename));
+			auto datFilename = std::format("{:X}.DAT", nameHash);
 			if(auto composedPath = folderPath / datFilename; std::filesystem::is_regular_file(composedPath)) {
-				return mco::FileStream::open(composedPath.string().c_str());
-			} else {
-				// If the .DAT name didn't work, then just try the clear name.
-				composedPath = folderPath / filename;
-				return mco::FileStream::open(composedPath.string().c_str());
+				return composedPath;
 			}
-		} else {
-			// All other file types are always clearnamed.
-			auto composedPath = folderPath / filename;
-			return mco::FileStream::open(composedPath.string().c_str());
+
+			// If the .DAT name didn't work, then just try the clear name.
 		}
+
+		// All other file types are always clearnamed.
+		return folderPath / filename;
 	}
 
 	/// This class wraps the logic of detecting the version of the JMMT game
 	/// that is being opened by the GameFileSystem implementation.
 	class GameDetector {
 		std::filesystem::path rootPath {};
+		std::filesystem::path cachePath {};
 		GameVersion detectedVersion {};
 		bool detected = false;
 
@@ -56,15 +66,31 @@ namespace jmmt::fs {
 			detected = true;
 		}
 
+		/// Returns the digest of the ELF at [path], from [pCache] if it has it. Returns an empty optional if the ELF couldn't be read.
+		std::optional<impl::ShaDigest> getElfDigest(const std::filesystem::path& path, const FileIdentity& identity, GameVersionCache* pCache) {
+			if(pCache) {
+				if(auto* pDigest = pCache->find(identity); pDigest)
+					return *pDigest;
+			}
+
+			JMMT_TRACE_SCOPE("GameDetector::hashElf");
+			auto digest = impl::sha256Digest(path);
+			if(digest && pCache)
+				pCache->add(identity, *digest);
+			return digest;
+		}
+
 	   public:
-		explicit GameDetector(const std::filesystem::path& rootPath)
-			: rootPath(rootPath) {
+		/// If [cachePath] isn't empty, ELF digests are cached in a file there (see [GameVersionCache]).
+		GameDetector(const std::filesystem::path& rootPath, const std::filesystem::path& cachePath)
+			: rootPath(rootPath), cachePath(cachePath) {
 		}
 
 		// TODO: This should probably throw explicit errors at some point detailing what failed,
 		// but for now, this works okay.
 
 		std::optional<GameVersion> detectVersion() {
+			JMMT_TRACE_SCOPE("GameDetector::detectVersion");
 			// First, check for folders in the root directory that should always exist.
 			// If any of these fail, then we are probably not in a JMMT game root,
 			// and thus we can't reliably detect any version of the game.
@@ -74,27 +100,40 @@ namespace jmmt::fs {
 			   !std::filesystem::is_directory(rootPath / "MUSIC"))
 				return std::nullopt;
 
+			std::optional<GameVersionCache> cache;
+			if(!cachePath.empty())
+				cache.emplace(cachePath / "game-versions.jmgv");
+
+			// Some versions share an ELF name, so each ELF is hashed at most once no matter how
+			// many versions it could be.
+			std::unordered_map<std::string_view, std::optional<impl::ShaDigest>> elfDigests;
+
 			// Probe for a game version.
 			// This should auto-update if/when new JMMT versions
 			// happen to be discovered. I doubt that'll happen, but futureproofing...
 			forEachGameVersion([&](GameVersion version) {
 				const auto slusName = getVersionSlusName(version);
-				if(std::filesystem::is_regular_file(rootPath / slusName)) {
-					// We found a canidate ELF filename which matches a version.
-					auto str = (rootPath / slusName).string();
-					auto stream = mco::FileStream::open(str.c_str());
-					auto hash = impl::sha256Digest(stream);
-					if(hash == *getVersionHash(version)) {
-						setDetectedVersion(version);
-						return false;
-					}
-				} else {
+				auto elfPath = rootPath / slusName;
+				auto identity = getFileIdentity(elfPath);
+				if(!identity)
 					return true;
-				}
 
+				// We found a canidate ELF filename which matches a version.
+				auto [it, inserted] = elfDigests.try_emplace(slusName);
+				if(inserted)
+					it->second = getElfDigest(elfPath, *identity, cache ? &*cache : nullptr);
+
+				if(it->second && *it->second == *getVersionHash(version)) {
+					setDetectedVersion(version);
+					return false;
+				}
 				return true;
 			});
 
+			// Failing to save only means the next detection hashes again.
+			if(cache)
+				cache->save();
+
 			// No version was detected by the above logic, so it's probably safe to say
 			// this isn't a JMMT filesystem.
 			if(!detected) {
@@ -108,8 +147,35 @@ namespace jmmt::fs {
 	class GameFileSystem::Impl {
 	   public:
 		std::filesystem::path rootPath;
+		std::filesystem::path indexCachePath;
+		std::filesystem::path imageCachePath;
 		std::optional<GameVersion> detectedVersion;
-		std::unordered_map<std::string, PackageMetadata> metadata;
+
+		/// If set, version detection is skipped and this version is assumed.
+		std::optional<GameVersion> assumedVersion;
+		PackageToc metadata;
+
+		/// Totals of the statistics of every package opened through this filesystem.
+		StatsCounters stats;
+
+		/// The memory budget every package opened through this filesystem draws from.
+		MemoryBudget memoryBudget;
+
+		/// Periodic statistics dumping. The mutex and condition variable let stopping
+		/// the dump wake the thread up instead of waiting out the interval.
+		std::mutex statsDumpMutex;
+		std::condition_variable_any statsDumpCondition;
+		std::jthread statsDumpThread;
+
+		/// The files in the game's folders, indexed by [FileType].
+		GameDirectoryIndex directoryIndex;
+
+		/// The game file index, and the packages files have been opened from through it (parallel to
+		/// the index's packages). Packages are held weakly, since packages hold a reference to this filesystem.
+		/// Packages aren't safe to use from more than one thread, so neither is any of this.
+		std::optional<GameFileIndex> fileIndex;
+		std::vector<std::weak_ptr<PakFileSystem>> fileIndexPackages;
+		MemoryReservation fileIndexReservation;
 
 		explicit constexpr Impl(const std::filesystem::path& path)
 			: rootPath(path) {
@@ -117,7 +183,12 @@ namespace jmmt::fs {
 		}
 
 		void scanVersionImpl() {
-			auto detector = GameDetector(rootPath);
+			if(assumedVersion.has_value()) {
+				detectedVersion = assumedVersion;
+				return;
+			}
+
+			auto detector = GameDetector(rootPath, indexCachePath);
 			detectedVersion = detector.detectVersion();
 		}
 
@@ -130,27 +201,12 @@ namespace jmmt::fs {
 				return false;
 			}
 
-			// Try and load package.toc data.
-			try {
-				auto packageTocFile = openFileImpl("package.toc", FileData);
-				auto nTocEntries = packageTocFile.getSize() / sizeof(structs::PackageTocHeader);
-				for(auto i = 0; i < nTocEntries; ++i) {
-					structs::PackageTocHeader tocEntry;
-					if(auto n = packageTocFile.read(&tocEntry, sizeof(tocEntry)); n != sizeof(tocEntry)) {
-						// A short read should be impossible.
-						detectedVersion = std::nullopt;
-						return false;
-					}
+			// List the game's folders, so opening files afterwards doesn't need to probe for them. If this
+			// fails, files are resolved by probing instead.
+			rescanDirectoriesImpl();
 
-					// Convert package.toc metadata to the libjmmt format.
-					metadata[tocEntry.fileName] = {
-						.nrPackageFiles = tocEntry.tocFileCount,
-						.chunkStartOffset = tocEntry.tocStartOffset,
-						.chunkDataSize = tocEntry.tocSize
-					};
-				}
-			} catch(std::system_error& err) {
-				// If this somehow fails, then the filesystem most likely isn't valid.
+			// Try and load package.toc data. If this somehow fails, then the filesystem most likely isn't valid.
+			if(!metadata.load(resolveFilePathImpl("package.toc", NameHash<"package.toc">, FileData))) {
 				detectedVersion = std::nullopt;
 				return false;
 			}
@@ -158,6 +214,27 @@ namespace jmmt::fs {
 			return true;
 		}
 
+		bool rescanDirectoriesImpl() {
+			JMMT_TRACE_SCOPE("GameFileSystem::rescanDirectories");
+			std::filesystem::path folderPaths[] = {
+				rootPath / getTypeFolderName(FileData),
+				rootPath / getTypeFolderName(FileIrx),
+				rootPath / getTypeFolderName(FileMovies),
+				rootPath / getTypeFolderName(FileMusic)
+			};
+			return directoryIndex.scan(folderPaths);
+		}
+
+		std::filesystem::path resolveFilePathImpl(std::string_view filename, Crc32Result nameHash, FileType type) const {
+			if(auto path = directoryIndex.resolve(type, filename, nameHash, type == FileData); path)
+				return *path;
+			return resolveGameFilePath(rootPath, filename, nameHash, type);
+		}
+
+		std::filesystem::path resolveFilePathImpl(std::string_view filename, FileType type) const {
+			return resolveFilePathImpl(filename, jmmt::hashString(filename), type);
+		}
+
 		bool isValidFilesystemImpl() const {
 			return getVersionImpl() != GameVersion::Invalid;
 		}
@@ -166,10 +243,10 @@ namespace jmmt::fs {
 			return detectedVersion.value_or(GameVersion::Invalid);
 		}
 
-		Ref<PakFileSystem> openPackageFileImpl(Ref<GameFileSystem> that, const std::string& packageFileName) {
-			if(auto it = metadata.find(packageFileName); it != metadata.end()) {
-				auto sp = std::make_shared<PakFileSystem>(that, it->second, packageFileName);
-				if(auto ec = sp->initialize(); ec != PakFileSystem::Success) {
+		Ref<PakFileSystem> openPackageFileImpl(Ref<GameFileSystem> that, const std::string& packageFileName, PakFileSystem::InitMode mode) {
+			if(auto* pMetadata = metadata.find(packageFileName); pMetadata) {
+				auto sp = std::make_shared<PakFileSystem>(that, *pMetadata, packageFileName);
+				if(auto ec = sp->initialize(mode); ec != PakFileSystem::Success) {
 					return nullptr;
 				}
 				return sp;
@@ -178,8 +255,145 @@ namespace jmmt::fs {
 			return nullptr;
 		}
 
+		std::unordered_map<std::string, Ref<PakFileSystem>> openAllPackagesImpl(Ref<GameFileSystem> that, u32 nThreads) {
+			std::vector<std::string> packageNames;
+			packageNames.reserve(metadata.size());
+			for(auto& [name, _] : metadata)
+				packageNames.emplace_back(name);
+
+			// Every worker writes only its own slot, so no locking is needed. Packages whose file
+			// couldn't be opened (for example, because it's missing) are left out, like any other failure.
+			std::vector<Ref<PakFileSystem>> packages(packageNames.size());
+			impl::parallelFor(packageNames.size(), nThreads, [&](usize i) {
+				try {
+					packages[i] = openPackageFileImpl(that, packageNames[i], PakFileSystem::InitEager);
+				} catch(std::system_error& err) {
+					packages[i] = nullptr;
+				}
+			});
+
+			std::unordered_map<std::string, Ref<PakFileSystem>> openedPackages;
+			for(usize i = 0; i < packages.size(); ++i) {
+				if(packages[i])
+					openedPackages.emplace(std::move(packageNames[i]), std::move(packages[i]));
+			}
+			return openedPackages;
+		}
+
+		/// Returns the identity of every package in package.toc, sorted by name.
+		std::vector<GameFileIndexPackage> getFileIndexPackages() const {
+			std::vector<GameFileIndexPackage> packages;
+			packages.reserve(metadata.size());
+			for(auto& [name, packageMetadata] : metadata) {
+				auto pakPath = resolveFilePathImpl(name, FileData);
+				std::error_code ec;
+				auto pakSize = std::filesystem::file_size(pakPath, ec);
+				auto pakModifiedTime = std::filesystem::last_write_time(pakPath, ec);
+
+				packages.push_back({ .name = std::string(name),
+									 .pakSize = ec ? 0 : static_cast<u64>(pakSize),
+									 .pakModifiedTime = ec ? 0 : static_cast<i64>(pakModifiedTime.time_since_epoch().count()),
+									 .chunkStartOffset = packageMetadata.chunkStartOffset,
+									 .chunkDataSize = packageMetadata.chunkDataSize,
+									 .nrPackageFiles = packageMetadata.nrPackageFiles });
+			}
+
+			std::sort(packages.begin(), packages.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
+			return packages;
+		}
+
+		bool buildFileIndexImpl(Ref<GameFileSystem> that, u32 nThreads) {
+			JMMT_TRACE_SCOPE("GameFileSystem::buildFileIndex");
+			if(!isValidFilesystemImpl())
+				return false;
+
+			auto packages = getFileIndexPackages();
+
+			std::filesystem::path cachePath;
+			if(!indexCachePath.empty()) {
+				std::error_code ec;
+				auto absoluteRootPath = std::filesystem::absolute(rootPath, ec).string();
+				cachePath = indexCachePath / std::format("game-files-{:08X}.jmgx", jmmt::hashStringCase(absoluteRootPath));
+			}
+
+			GameFileIndex index;
+			if(cachePath.empty() || !index.load(cachePath, packages)) {
+				// Lazily initialized packages know the name hashes of their files without building any file metadata.
+				// Every worker writes only its own slot, so no locking is needed.
+				std::vector<std::vector<u32>> fileNameHashes(packages.size());
+				std::vector<u8> packagesOpened(packages.size());
+				impl::parallelFor(packages.size(), nThreads, [&](usize i) {
+					try {
+						if(auto pak = openPackageFileImpl(that, packages[i].name, PakFileSystem::InitLazy); pak) {
+							fileNameHashes[i] = pak->getFileNameHashes();
+							packagesOpened[i] = true;
+						}
+					} catch(std::system_error& err) {
+						// The package's file is missing or unreadable; it's left out like any other failure.
+					}
+				});
+
+				index.build(std::move(packages), fileNameHashes);
+				// Don't save an index missing packages which failed to open, so they get another try next time.
+				if(!cachePath.empty() && std::find(packagesOpened.begin(), packagesOpened.end(), false) == packagesOpened.end()) {
+					std::error_code ec;
+					std::filesystem::create_directories(indexCachePath, ec);
+					index.save(cachePath);
+				}
+			}
+
+			fileIndexPackages.assign(index.getPackages().size(), {});
+			fileIndexReservation.release();
+			fileIndexReservation = memoryBudget.reserve(index.getMemorySize(), stats);
+			fileIndex = std::move(index);
+			return true;
+		}
+
+		Unique<PakFileStream> openPackagedFileImpl(Ref<GameFileSystem> that, std::string_view fileName) {
+			if(!fileIndex)
+				return nullptr;
+
+			auto* pPackage = fileIndex->findPackage(jmmt::hashString(fileName));
+			if(!pPackage)
+				return nullptr;
+
+			try {
+				auto& weakPak = fileIndexPackages[pPackage - fileIndex->getPackages().data()];
+				auto pak = weakPak.lock();
+				if(!pak) {
+					pak = openPackageFileImpl(that, pPackage->name, PakFileSystem::InitLazy);
+					if(!pak)
+						return nullptr;
+					weakPak = pak;
+				}
+
+				return std::make_unique<PakFileStream>(PakFileStream::open(pak, fileName));
+			} catch(std::runtime_error& err) {
+				// This catches the std::system_error thrown when the package's file can't be opened, too.
+				return nullptr;
+			}
+		}
+
+		void startStatsDumpImpl(std::chrono::milliseconds interval, std::function<void(const Stats&)> callback) {
+			stopStatsDumpImpl();
+			statsDumpThread = std::jthread([this, interval, callback = std::move(callback)](std::stop_token stopToken) {
+				std::unique_lock lock(statsDumpMutex);
+				// The wait only returns true once a stop is requested; timing out returns false.
+				while(!statsDumpCondition.wait_for(lock, stopToken, interval, [&] { return stopToken.stop_requested(); }))
+					callback(stats.snapshot());
+			});
+		}
+
+		void stopStatsDumpImpl() {
+			if(!statsDumpThread.joinable())
+				return;
+			statsDumpThread.request_stop();
+			statsDumpThread.join();
+		}
+
 		mco::FileStream openFileImpl(const std::string& filename, FileType type) {
-			return openGameFile(rootPath, filename, type);
+			auto path = resolveFilePathImpl(filename, type);
+			return mco::FileStream::open(path.string().c_str());
 		}
 	};
 
@@ -189,12 +403,19 @@ namespace jmmt::fs {
 		: impl(std::make_unique<Impl>(path)) {
 	}
 
-	GameFileSystem::~GameFileSystem() = default;
+	GameFileSystem::~GameFileSystem() {
+		// The dump thread uses the statistics, so it needs to stop before they go away.
+		impl->stopStatsDumpImpl();
+	}
 
 	bool GameFileSystem::initialize() {
 		return impl->initalizeImpl();
 	}
 
+	void GameFileSystem::setAssumedVersion(GameVersion version) {
+		impl->assumedVersion = version;
+	}
+
 	bool GameFileSystem::isValidFilesystem() const {
 		return impl->isValidFilesystemImpl();
 	}
@@ -203,18 +424,95 @@ namespace jmmt::fs {
 		return impl->getVersionImpl();
 	}
 
-	const std::unordered_map<std::string, PackageMetadata>& GameFileSystem::getPackageMetadata() const {
+	const PackageToc& GameFileSystem::getPackageMetadata() const {
 		return impl->metadata;
 	}
 
-	Ref<PakFileSystem> GameFileSystem::openPackageFile(const std::string& packageFileName) {
-		return impl->openPackageFileImpl(shared_from_this(), packageFileName);
+	Ref<PakFileSystem> GameFileSystem::openPackageFile(const std::string& packageFileName, PakFileSystem::InitMode mode) {
+		return impl->openPackageFileImpl(shared_from_this(), packageFileName, mode);
+	}
+
+	std::unordered_map<std::string, Ref<PakFileSystem>> GameFileSystem::openAllPackages(u32 nThreads) {
+		return impl->openAllPackagesImpl(shared_from_this(), nThreads);
+	}
+
+	bool GameFileSystem::buildFileIndex(u32 nThreads) {
+		return impl->buildFileIndexImpl(shared_from_this(), nThreads);
+	}
+
+	bool GameFileSystem::hasFileIndex() const {
+		return impl->fileIndex.has_value();
+	}
+
+	std::optional<std::string_view> GameFileSystem::findFilePackage(std::string_view fileName) const {
+		if(!impl->fileIndex)
+			return std::nullopt;
+
+		if(auto* pPackage = impl->fileIndex->findPackage(jmmt::hashString(fileName)); pPackage)
+			return pPackage->name;
+		return std::nullopt;
+	}
+
+	Unique<PakFileStream> GameFileSystem::openPackagedFile(std::string_view fileName) {
+		return impl->openPackagedFileImpl(shared_from_this(), fileName);
 	}
 
 	mco::FileStream GameFileSystem::openFile(const std::string& filename, FileType type) {
 		return impl->openFileImpl(filename, type);
 	}
 
+	std::filesystem::path GameFileSystem::getFilePath(const std::string& filename, FileType type) const {
+		return impl->resolveFilePathImpl(filename, type);
+	}
+
+	bool GameFileSystem::rescanDirectories() {
+		return impl->rescanDirectoriesImpl();
+	}
+
+	void GameFileSystem::setIndexCachePath(const std::filesystem::path& path) {
+		impl->indexCachePath = path;
+	}
+
+	const std::filesystem::path& GameFileSystem::getIndexCachePath() const {
+		return impl->indexCachePath;
+	}
+
+	void GameFileSystem::setImageCachePath(const std::filesystem::path& path) {
+		impl->imageCachePath = path;
+	}
+
+	const std::filesystem::path& GameFileSystem::getImageCachePath() const {
+		return impl->imageCachePath;
+	}
+
+	StatsCounters& GameFileSystem::getStatsCounters() {
+		return impl->stats;
+	}
+
+	MemoryBudget& GameFileSystem::getMemoryBudget() {
+		return impl->memoryBudget;
+	}
+
+	void GameFileSystem::setMemoryLimit(u64 bytes) {
+		impl->memoryBudget.setLimit(bytes);
+	}
+
+	u64 GameFileSystem::getMemoryLimit() const {
+		return impl->memoryBudget.getLimit();
+	}
+
+	Stats GameFileSystem::getStats() const {
+		return impl->stats.snapshot();
+	}
+
+	void GameFileSystem::startStatsDump(std::chrono::milliseconds interval, std::function<void(const Stats&)> callback) {
+		impl->startStatsDumpImpl(interval, std::move(callback));
+	}
+
+	void GameFileSystem::stopStatsDump() {
+		impl->stopStatsDumpImpl();
+	}
+
 	Ref<GameFileSystem> createGameFileSystem(const std::filesystem::path& path) {
 		if(auto sp = std::make_shared<GameFileSystem>(path); sp->initialize())
 			return sp;
@@ -222,4 +520,12 @@ namespace jmmt::fs {
 		return nullptr;
 	}
 
+	Ref<GameFileSystem> createGameFileSystem(const std::filesystem::path& path, GameVersion assumedVersion) {
+		auto sp = std::make_shared<GameFileSystem>(path);
+		sp->setAssumedVersion(assumedVersion);
+		if(sp->initialize())
+			return sp;
+		return nullptr;
+	}
+
 } // namespace jmmt::fs
@@ -0,0 +1,100 @@
+#include <cstring>
+#include <jmmt/fourcc.hpp>
+#include <libjmmt/impl/replace_file.hpp>
+#include <mco/io/file_stream.hpp>
+
+#include "game_version_cache.hpp"
+
+#if __has_include(<sys/stat.h>) && __has_include(<unistd.h>)
+	#include <sys/stat.h>
+	#define JMMT_HAVE_STAT
+#endif
+
+namespace jmmt::fs {
+
+	namespace {
+		struct CacheHeader {
+			constexpr static auto MAGIC = FourCCGenerator<>::generate<"JMGV">();
+			constexpr static u32 VERSION = 1;
+
+			FourCC magic;
+			u32 version;
+			u32 entryCount;
+			u32 reserved;
+		};
+	} // namespace
+
+	std::optional<FileIdentity> getFileIdentity(const std::filesystem::path& path) {
+#ifdef JMMT_HAVE_STAT
+		struct stat st {};
+		if(::stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode))
+			return std::nullopt;
+
+		return FileIdentity {
+			.device = static_cast<u64>(st.st_dev),
+			.inode = static_cast<u64>(st.st_ino),
+			.size = static_cast<u64>(st.st_size),
+	#ifdef __APPLE__
+			.modifiedTime = static_cast<i64>(st.st_mtimespec.tv_sec) * 1'000'000'000 + st.st_mtimespec.tv_nsec
+	#else
+			.modifiedTime = static_cast<i64>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec
+	#endif
+		};
+#else
+		std::error_code ec;
+		if(!std::filesystem::is_regular_file(path, ec))
+			return std::nullopt;
+		auto size = std::filesystem::file_size(path, ec);
+		auto modifiedTime = std::filesystem::last_write_time(path, ec);
+		if(ec)
+			return std::nullopt;
+
+		return FileIdentity { .device = 0, .inode = 0, .size = static_cast<u64>(size), .modifiedTime = static_cast<i64>(modifiedTime.time_since_epoch().count()) };
+#endif
+	}
+
+	GameVersionCache::GameVersionCache(const std::filesystem::path& path)
+		: path(path) {
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+
+			CacheHeader header {};
+			if(stream.read(&header, sizeof(header)) != sizeof(header) || header.magic != CacheHeader::MAGIC || header.version != CacheHeader::VERSION || header.entryCount > MaxEntries)
+				return;
+
+			entries.resize(header.entryCount);
+			if(stream.read(entries.data(), entries.size() * sizeof(Entry)) != entries.size() * sizeof(Entry))
+				entries.clear();
+		} catch(std::system_error& err) {
+			entries.clear();
+		}
+	}
+
+	const impl::ShaDigest* GameVersionCache::find(const FileIdentity& identity) const {
+		for(auto& entry : entries) {
+			if(entry.identity == identity)
+				return &entry.digest;
+		}
+		return nullptr;
+	}
+
+	void GameVersionCache::add(const FileIdentity& identity, const impl::ShaDigest& digest) {
+		std::erase_if(entries, [&](const Entry& entry) { return entry.identity == identity; });
+		if(entries.size() >= MaxEntries)
+			entries.erase(entries.begin());
+		entries.push_back({ .identity = identity, .digest = digest });
+		modified = true;
+	}
+
+	bool GameVersionCache::save() const {
+		if(!modified)
+			return true;
+
+		return impl::writeFileReplacing(path, [&](mco::FileStream& stream) {
+			auto header = CacheHeader { .magic = CacheHeader::MAGIC, .version = CacheHeader::VERSION, .entryCount = static_cast<u32>(entries.size()) };
+			return stream.write(&header, sizeof(header)) == sizeof(header) && stream.write(entries.data(), entries.size() * sizeof(Entry)) == entries.size() * sizeof(Entry);
+		});
+	}
+
+} // namespace jmmt::fs
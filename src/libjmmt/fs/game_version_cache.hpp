@@ -0,0 +1,55 @@
+//! Game version detection cache. This is an implementation detail of the game filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <filesystem>
+#include <jmmt/impl/sha256.hpp>
+#include <mco/base_types.hpp>
+#include <optional>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// Identifies a file on disk. If any of this changes, the file is assumed to have changed.
+	struct FileIdentity {
+		u64 device;
+		u64 inode;
+		u64 size;
+		i64 modifiedTime;
+
+		bool operator==(const FileIdentity&) const = default;
+	};
+
+	/// Returns the identity of the regular file at [path], or an empty optional if there isn't one.
+	/// Where there's no notion of devices and inodes, those are left zero.
+	std::optional<FileIdentity> getFileIdentity(const std::filesystem::path& path);
+
+	/// The digests of game ELFs hashed by version detection, keyed by the ELF's identity. Kept in a small
+	/// sidecar file, so detecting the version of the same game again doesn't need to hash the ELF.
+	class GameVersionCache {
+		struct Entry {
+			FileIdentity identity;
+			impl::ShaDigest digest;
+		};
+
+		std::filesystem::path path;
+		std::vector<Entry> entries;
+		bool modified = false;
+
+		/// Caps the file at a few KiB; the oldest entries are dropped past this.
+		constexpr static usize MaxEntries = 64;
+
+	   public:
+		/// Loads the cache from [path]. A missing or malformed file gives an empty cache.
+		explicit GameVersionCache(const std::filesystem::path& path);
+
+		/// Returns the digest of the file with [identity], or a null pointer if it isn't cached.
+		const impl::ShaDigest* find(const FileIdentity& identity) const;
+
+		/// Adds (or replaces) the digest of the file with [identity].
+		void add(const FileIdentity& identity, const impl::ShaDigest& digest);
+
+		/// Saves the cache back, if anything was added. The file is written to a temporary file first.
+		bool save() const;
+	};
+
+} // namespace jmmt::fs
@@ -0,0 +1,123 @@
+//! Memory budgeting. This is an implementation detail of the filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <atomic>
+#include <mco/base_types.hpp>
+#include <optional>
+#include <utility>
+
+#include "stats_counters.hpp"
+
+namespace jmmt::fs {
+
+	class MemoryBudget;
+
+	/// Memory reserved from a [MemoryBudget]. The memory is given back when the reservation is destroyed.
+	class MemoryReservation {
+		MemoryBudget* pBudget = nullptr;
+		StatsCounters* pStats = nullptr;
+		u64 size = 0;
+
+		friend class MemoryBudget;
+
+		MemoryReservation(MemoryBudget& budget, StatsCounters& stats, u64 size)
+			: pBudget(&budget), pStats(&stats), size(size) {
+		}
+
+	   public:
+		MemoryReservation() = default;
+
+		MemoryReservation(MemoryReservation&& mv)
+			: pBudget(std::exchange(mv.pBudget, nullptr)), pStats(std::exchange(mv.pStats, nullptr)), size(std::exchange(mv.size, 0)) {
+		}
+
+		MemoryReservation& operator=(MemoryReservation&& mv) {
+			if(this != &mv) {
+				release();
+				pBudget = std::exchange(mv.pBudget, nullptr);
+				pStats = std::exchange(mv.pStats, nullptr);
+				size = std::exchange(mv.size, 0);
+			}
+			return *this;
+		}
+
+		MemoryReservation(const MemoryReservation&) = delete;
+
+		~MemoryReservation() {
+			release();
+		}
+
+		u64 getSize() const {
+			return size;
+		}
+
+		/// Gives the memory back early.
+		inline void release();
+	};
+
+	/// A limit on the memory a game filesystem (and every package opened through it) holds for buffers, indices
+	/// and caches. Memory the filesystem can't do without is always reserved, even past the limit; optional memory
+	/// (like read-ahead buffers) is only reserved if it fits, and users fall back to working without it otherwise.
+	/// Reserving and releasing is lock-free, so it's safe from any thread.
+	class MemoryBudget {
+		/// The limit in bytes, or 0 for no limit.
+		std::atomic<u64> limit {};
+		std::atomic<u64> used {};
+
+		friend class MemoryReservation;
+
+		void release(u64 size) {
+			used.fetch_sub(size, std::memory_order_relaxed);
+		}
+
+	   public:
+		void setLimit(u64 bytes) {
+			limit.store(bytes, std::memory_order_relaxed);
+		}
+
+		u64 getLimit() const {
+			return limit.load(std::memory_order_relaxed);
+		}
+
+		/// Returns true if [size] more bytes currently fit in the limit. Nothing is reserved or recorded,
+		/// so this is fine to poll; the room can be gone again by the time it's reserved.
+		bool fits(u64 size) const {
+			auto currentLimit = getLimit();
+			return currentLimit == 0 || used.load(std::memory_order_relaxed) + size <= currentLimit;
+		}
+
+		/// Reserves [size] bytes regardless of the limit, recording the allocation to [stats].
+		MemoryReservation reserve(u64 size, StatsCounters& stats) {
+			used.fetch_add(size, std::memory_order_relaxed);
+			stats.recordMemoryAllocated(size);
+			return MemoryReservation(*this, stats, size);
+		}
+
+		/// Reserves [size] bytes if they fit in the limit. Returns an empty optional (and records a denial
+		/// to [stats]) if they don't.
+		std::optional<MemoryReservation> tryReserve(u64 size, StatsCounters& stats) {
+			auto currentLimit = getLimit();
+			auto current = used.load(std::memory_order_relaxed);
+			do {
+				if(currentLimit != 0 && (current + size > currentLimit)) {
+					stats.recordMemoryBudgetDenial();
+					return std::nullopt;
+				}
+			} while(!used.compare_exchange_weak(current, current + size, std::memory_order_relaxed));
+
+			stats.recordMemoryAllocated(size);
+			return MemoryReservation(*this, stats, size);
+		}
+	};
+
+	inline void MemoryReservation::release() {
+		if(!pBudget)
+			return;
+		pBudget->release(size);
+		pStats->recordMemoryFreed(size);
+		pBudget = nullptr;
+		pStats = nullptr;
+		size = 0;
+	}
+
+} // namespace jmmt::fs
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/overlay_filesystem.hpp>
+#include <jmmt/fs/pak_file_stream.hpp>
+#include <mco/io/file_stream.hpp>
+#include <unordered_map>
+
+namespace jmmt::fs {
+
+	struct OverlayFileSystem::Impl {
+		/// Where a name hash resolves to. Loose files are indices into [looseFiles]; package files are
+		/// indices into [packages], and the name the package stores the file under.
+		struct Entry {
+			bool loose;
+			u32 index;
+			std::string_view packageFileName;
+		};
+
+		struct Package {
+			std::string name;
+			Ref<PakFileSystem> pak;
+		};
+
+		Ref<GameFileSystem> fs;
+
+		std::vector<std::filesystem::path> looseRoots;
+		std::vector<std::filesystem::path> looseFiles;
+		std::vector<Package> packages;
+
+		std::unordered_map<u32, Entry> entries;
+
+		explicit Impl(Ref<GameFileSystem> fs)
+			: fs(std::move(fs)) {
+		}
+
+		void addPackageEntries(u32 packageIndex) {
+			for(auto file : packages[packageIndex].pak->enumerateFiles()) {
+				auto [it, inserted] = entries.try_emplace(jmmt::hashString(file.name), Entry { .loose = false, .index = packageIndex, .packageFileName = file.name });
+
+				// Loose files shadow every package, no matter when they were added.
+				if(!inserted && !it->second.loose)
+					it->second = Entry { .loose = false, .index = packageIndex, .packageFileName = file.name };
+			}
+		}
+
+		bool scanLooseRoot(const std::filesystem::path& root) {
+			std::error_code ec;
+			for(auto it = std::filesystem::recursive_directory_iterator(root, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+				// Entries whose type can't be read (like symlink loops) fail the scan, instead of throwing.
+				// Dangling symlinks aren't files, so they're skipped like before.
+				auto isFile = it->is_regular_file(ec);
+				if(ec == std::errc::no_such_file_or_directory)
+					ec.clear();
+				if(ec)
+					break;
+				if(!isFile)
+					continue;
+
+				auto name = it->path().lexically_relative(root).generic_string();
+				std::replace(name.begin(), name.end(), '/', '\\');
+
+				entries.insert_or_assign(jmmt::hashString(name), Entry { .loose = true, .index = static_cast<u32>(looseFiles.size()) });
+				looseFiles.push_back(it->path());
+			}
+			return !ec;
+		}
+
+		bool rescanLooseRootsImpl() {
+			// Package entries don't change, but loose files which went away may have been shadowing them,
+			// so the table is rebuilt from scratch. Packages go first, since loose files shadow them.
+			entries.clear();
+			looseFiles.clear();
+			for(u32 i = 0; i < packages.size(); ++i)
+				addPackageEntries(i);
+
+			bool success = true;
+			for(auto& root : looseRoots)
+				success &= scanLooseRoot(root);
+			return success;
+		}
+
+		bool addPackageImpl(const std::string& packageName, PakFileSystem::InitMode mode) {
+			auto pak = fs->openPackageFile(packageName, mode);
+			if(!pak)
+				return false;
+
+			packages.push_back(Package { .name = packageName, .pak = std::move(pak) });
+			addPackageEntries(static_cast<u32>(packages.size() - 1));
+			return true;
+		}
+
+		const Entry* findEntry(std::string_view name) const {
+			u32 nameHash;
+			if(name.find('/') == std::string_view::npos) {
+				nameHash = jmmt::hashString(name);
+			} else {
+				std::string normalized(name);
+				std::replace(normalized.begin(), normalized.end(), '/', '\\');
+				nameHash = jmmt::hashString(normalized);
+			}
+
+			if(auto it = entries.find(nameHash); it != entries.end())
+				return &it->second;
+			return nullptr;
+		}
+
+		Unique<mco::Stream> openFileImpl(std::string_view name) {
+			auto* pEntry = findEntry(name);
+			if(!pEntry)
+				return nullptr;
+
+			try {
+				if(pEntry->loose) {
+					auto str = looseFiles[pEntry->index].string();
+					return std::make_unique<mco::FileStream>(mco::FileStream::open(str.c_str()));
+				}
+				return std::make_unique<PakFileStream>(PakFileStream::open(packages[pEntry->index].pak, pEntry->packageFileName));
+			} catch(std::system_error& err) {
+				return nullptr;
+			} catch(std::runtime_error& err) {
+				return nullptr;
+			}
+		}
+
+		std::optional<std::vector<u8>> readWholeFileImpl(std::string_view name) {
+			auto* pEntry = findEntry(name);
+			if(!pEntry)
+				return std::nullopt;
+
+			if(!pEntry->loose)
+				return packages[pEntry->index].pak->readWholeFile(pEntry->packageFileName);
+
+			try {
+				auto str = looseFiles[pEntry->index].string();
+				auto stream = mco::FileStream::open(str.c_str());
+				std::vector<u8> data(stream.getSize());
+				if(stream.read(data.data(), data.size()) != data.size())
+					return std::nullopt;
+				return data;
+			} catch(std::system_error& err) {
+				return std::nullopt;
+			}
+		}
+	};
+
+	OverlayFileSystem::OverlayFileSystem(Ref<GameFileSystem> fs) {
+		impl = std::make_unique<Impl>(std::move(fs));
+	}
+
+	OverlayFileSystem::~OverlayFileSystem() = default;
+
+	bool OverlayFileSystem::addLooseRoot(const std::filesystem::path& root) {
+		impl->looseRoots.push_back(root);
+		return impl->scanLooseRoot(root);
+	}
+
+	bool OverlayFileSystem::rescanLooseRoots() {
+		return impl->rescanLooseRootsImpl();
+	}
+
+	bool OverlayFileSystem::addPackage(const std::string& packageName, PakFileSystem::InitMode mode) {
+		return impl->addPackageImpl(packageName, mode);
+	}
+
+	bool OverlayFileSystem::addAllPackages(PakFileSystem::InitMode mode) {
+		std::vector<std::string> packageNames;
+		for(auto& [name, _] : impl->fs->getPackageMetadata())
+			packageNames.emplace_back(name);
+		std::sort(packageNames.begin(), packageNames.end());
+
+		bool success = true;
+		for(auto& name : packageNames)
+			success &= impl->addPackageImpl(name, mode);
+		return success;
+	}
+
+	std::optional<OverlayFileSystem::Resolution> OverlayFileSystem::resolve(std::string_view name) const {
+		auto* pEntry = impl->findEntry(name);
+		if(!pEntry)
+			return std::nullopt;
+
+		if(pEntry->loose)
+			return Resolution { .loosePath = impl->looseFiles[pEntry->index] };
+
+		auto& package = impl->packages[pEntry->index];
+		return Resolution { .package = package.pak, .packageName = package.name, .packageFileName = std::string(pEntry->packageFileName) };
+	}
+
+	bool OverlayFileSystem::exists(std::string_view name) const {
+		return impl->findEntry(name) != nullptr;
+	}
+
+	Unique<mco::Stream> OverlayFileSystem::openFile(std::string_view name) {
+		return impl->openFileImpl(name);
+	}
+
+	std::optional<std::vector<u8>> OverlayFileSystem::readWholeFile(std::string_view name) {
+		return impl->readWholeFileImpl(name);
+	}
+
+} // namespace jmmt::fs
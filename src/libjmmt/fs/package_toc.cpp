@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstring>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/package_toc.hpp>
+#include <mco/io/file_stream.hpp>
+
+namespace jmmt::fs {
+
+	bool PackageToc::load(const std::filesystem::path& path) {
+		headers.clear();
+		entries.clear();
+		hashIndex.clear();
+
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+			headers.resize(stream.getSize() / sizeof(structs::PackageTocHeader));
+
+			auto size = headers.size() * sizeof(structs::PackageTocHeader);
+			if(stream.read(headers.data(), size) != size) {
+				// A short read should be impossible.
+				headers.clear();
+				return false;
+			}
+		} catch(std::system_error& err) {
+			headers.clear();
+			return false;
+		}
+
+		entries.reserve(headers.size());
+		hashIndex.reserve(headers.size());
+		for(auto& header : headers) {
+			// Names fill the whole field if they're long enough, so they aren't always terminated.
+			auto name = std::string_view(header.fileName, strnlen(header.fileName, sizeof(header.fileName)));
+
+			// Index by the hash of the name instead of the hash package.toc stores, so that a package.toc
+			// written by something which hashes names differently still works (and lookups never need a scan).
+			hashIndex.emplace_back(jmmt::hashString(name), static_cast<u32>(entries.size()));
+			entries.push_back({ .name = name,
+								.metadata = {
+								.nrPackageFiles = header.tocFileCount,
+								.chunkStartOffset = header.tocStartOffset,
+								.chunkDataSize = header.tocSize } });
+		}
+		std::sort(hashIndex.begin(), hashIndex.end());
+
+		// Drop every entry a later entry of the same name replaces. These have the same hash,
+		// so they're next to each other in the index, the later one last.
+		std::vector<bool> replaced(entries.size());
+		bool anyReplaced = false;
+		for(usize i = 0; i < hashIndex.size(); ++i) {
+			for(usize j = i + 1; j < hashIndex.size() && hashIndex[j].first == hashIndex[i].first; ++j) {
+				if(entries[hashIndex[i].second].name == entries[hashIndex[j].second].name) {
+					replaced[hashIndex[i].second] = true;
+					anyReplaced = true;
+					break;
+				}
+			}
+		}
+
+		if(anyReplaced) {
+			std::vector<u32> newIndices(entries.size());
+			usize nKept = 0;
+			for(usize i = 0; i < entries.size(); ++i) {
+				newIndices[i] = static_cast<u32>(nKept);
+				if(!replaced[i])
+					entries[nKept++] = entries[i];
+			}
+			entries.resize(nKept);
+
+			std::erase_if(hashIndex, [&](const auto& indexEntry) { return replaced[indexEntry.second]; });
+			for(auto& [_, index] : hashIndex)
+				index = newIndices[index];
+		}
+
+		return true;
+	}
+
+	const PackageMetadata* PackageToc::find(std::string_view name) const {
+		auto nameHash = jmmt::hashString(name);
+		for(auto it = std::lower_bound(hashIndex.begin(), hashIndex.end(), std::pair<u32, u32>(nameHash, 0)); it != hashIndex.end() && it->first == nameHash; ++it) {
+			if(auto& entry = entries[it->second]; entry.name == name)
+				return &entry.metadata;
+		}
+		return nullptr;
+	}
+
+} // namespace jmmt::fs
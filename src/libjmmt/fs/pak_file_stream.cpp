@@ -17,12 +17,15 @@ namespace jmmt::fs {
 	PakFileStream::PakFileStream(PakFileStream&& mv) {
 		pakFs = mv.pakFs;
 		pakFd = mv.pakFd;
+		size = mv.size;
 		mv.pakFs.reset();
 		mv.pakFd = -1;
 	}
 
 	PakFileStream::~PakFileStream() {
-		pakFs->fileClose(pakFd);
+		// Moved-from streams don't own a file anymore.
+		if(pakFs)
+			pakFs->fileClose(pakFd);
 	}
 
 	u64 PakFileStream::read(void* buffer, u64 length) {
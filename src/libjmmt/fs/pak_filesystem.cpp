@@ -1,7 +1,6 @@
 #define USE_V2_FREELIST
 
 #include <jmmt/crc.hpp>
-#include <jmmt/fourcc.hpp>
 #include <jmmt/fs/game_filesystem.hpp>
 #include <jmmt/fs/pak_filesystem.hpp>
 #ifdef USE_V2_FREELIST
@@ -11,61 +10,20 @@
 #endif
 #include <jmmt/impl/lazy.hpp>
 #include <jmmt/lzss/decompress.hpp>
-#include <jmmt/structs/package/file.hpp>
-#include <jmmt/structs/package/group.hpp>
+#include <jmmt/trace.hpp>
 #include <mco/base_types.hpp>
+#include <algorithm>
 #include <mco/io/file_stream.hpp>
-#include <mco/io/memory_stream.hpp>
 #include <unordered_map>
+#include <unordered_set>
 
-namespace jmmt::fs {
-
-	/// This data is used to store the chunk information.
-	/// We pre-create this for every file inside of a package file
-	/// when initializing the package filesystem.
-	struct FileMetadata {
-		struct ChunkMetadata {
-			u32 chunkByteOffset;	   // The offset where this chunk is placed
-			u32 chunkDataOffset;	   // Offset in .pak file where this chunk starts
-			u32 chunkDataSize;		   // The size of the chunk data inside of the pak
-			u32 chunkUncompressedSize; // The uncompressed size of the chunk.
-			bool compressed;		   // True if this chunk is compressed.
-		};
-
-		u32 nChunks;
-		ChunkMetadata* pChunkMetaEntries;
-
-		// TODO: Should these be optional? The only hash that should always exist
-		// (and does) is the file name itself, which this struct doesn't store
-		std::string sourceName;
-		std::string sourceConvertName;
-		std::string sourceCompressName;
-		std::string typeName;
-
-		u32 fileSize;
-		u32 dateStamp;
-
-		FileMetadata(u32 nChunks) : nChunks(nChunks) {
-			pChunkMetaEntries = new ChunkMetadata[nChunks];
-		}
-
-		// Can't be relocated. Files will only retain const& non-owning references
-		// to a particular chunk map instance which matches the file they have open.
-		FileMetadata(const FileMetadata&) = delete;
-		FileMetadata(FileMetadata&& move) = delete;
-
-		~FileMetadata() {
-			delete[] pChunkMetaEntries;
-		}
+#include "pak_image.hpp"
+#include "memory_budget.hpp"
+#include "pak_index.hpp"
+#include "pak_prefetcher.hpp"
+#include "stats_counters.hpp"
 
-		ChunkMetadata& operator[](usize index) {
-			return pChunkMetaEntries[index];
-		}
-
-		const ChunkMetadata& operator[](usize index) const {
-			return pChunkMetaEntries[index];
-		}
-	};
+namespace jmmt::fs {
 
 	/// A opened package file. This class isn't exposed to users directly,
 	/// but rather its methods can be called via handles.
@@ -74,14 +32,44 @@ namespace jmmt::fs {
 		/// The metadata for this file.
 		const FileMetadata& metadata;
 
+		/// The chunks of this file.
+		std::span<const ChunkMetadata> chunks;
+
 		/// A 64k buffer which we decompress or copy chunk data into
 		Unique<u8[]> chunkBuffer;
 
-		/// A 64k buffer which we read the raw chunk data buffer from the file into.
+		/// A buffer which raw chunk data is read from the file into. Runs of chunks which are laid out
+		/// back to back in the .pak file are read into this buffer with a single read, and then
+		/// decoded from it one at a time. See [fillReadBuffer].
 		Unique<u8[]> chunkReadBuffer;
 
-		/// A file stream with the .pak file opened
-		mco::FileStream packageFileStream;
+		/// The size of the read buffer.
+		u32 chunkReadBufferSize;
+
+		/// The .pak file offset of the data currently in the read buffer, and how much of it there is.
+		u32 chunkReadBufferOffset = 0;
+		u32 chunkReadBufferLength = 0;
+
+		/// A file stream with the .pak file opened. Files read from a package image don't have one.
+		std::optional<mco::FileStream> packageFileStream;
+
+		/// The decompressed data of this file in a package image, if it's read from one.
+		/// Reads from it are plain copies; none of the chunk machinery is used.
+		std::optional<std::span<const u8>> imageData;
+
+		/// Statistics of the package this file is in.
+		StatsCounters& stats;
+
+		/// The package's prefetcher, if it has a prefetch plan.
+		Ref<PakPrefetcher> prefetcher;
+
+		/// The memory the buffers above need to read at all, and the extra memory for reading
+		/// further ahead than a single chunk, if the memory budget allowed for it.
+		MemoryReservation bufferReservation;
+		MemoryReservation readAheadReservation;
+
+		/// Which chunks have been decoded at least once, so that decoding them again can be counted.
+		std::vector<bool> decodedChunks;
 
 		/// The index of the currently active chunk.
 		u16 currentChunk;
@@ -99,8 +87,8 @@ namespace jmmt::fs {
 		u32 findChunkIndex(u32 offset) {
 			u32 cumulativeOffset = 0;
 
-			for(u32 i = 0; i < metadata.nChunks; ++i) {
-				cumulativeOffset += metadata[i].chunkUncompressedSize;
+			for(u32 i = 0; i < chunks.size(); ++i) {
+				cumulativeOffset += chunks[i].chunkUncompressedSize;
 				if(offset < cumulativeOffset) {
 					return i;
 				}
@@ -112,14 +100,14 @@ namespace jmmt::fs {
 		u32 getChunkTotalSize(u32 chunkIndex) {
 			u32 cumulativeOffset = 0;
 			for(u32 i = 0; i < chunkIndex; ++i) {
-				cumulativeOffset += metadata[i].chunkUncompressedSize;
+				cumulativeOffset += chunks[i].chunkUncompressedSize;
 			}
 			return cumulativeOffset;
 		}
 
 		void advanceToChunk(u32 chunkIndex) {
 			// don't advance if it's out of range
-			if(chunkIndex > metadata.nChunks)
+			if(chunkIndex >= chunks.size())
 				return;
 			currentChunk = chunkIndex;
 			currentChunkByteOffset = 0;
@@ -128,25 +116,70 @@ namespace jmmt::fs {
 
 		void updateChunkBuffer() {
 			// Cache the uncompressed size of the chunk.
-			currentChunkByteSize = metadata[currentChunk].chunkUncompressedSize;
+			auto& chunk = chunks[currentChunk];
+			currentChunkByteSize = chunk.chunkUncompressedSize;
+
+			// Chunks the prefetcher already decoded only need to be copied out.
+			if(prefetcher && prefetcher->take(chunk, &chunkBuffer[0])) {
+				decodedChunks[currentChunk] = true;
+				return;
+			}
 
-			// Read the chunk data from the package file into the read buffer.
-			packageFileStream.seek(metadata[currentChunk].chunkDataOffset, mco::Stream::Begin);
-			packageFileStream.read(&chunkReadBuffer[0], metadata[currentChunk].chunkDataSize);
+			// Read the chunk data from the package file, unless an earlier read already brought it in.
+			auto buffered = isChunkBuffered(chunk);
+			stats.recordReadBuffer(buffered);
+			if(!buffered)
+				fillReadBuffer(currentChunk);
+			auto* pChunkData = &chunkReadBuffer[chunk.chunkDataOffset - chunkReadBufferOffset];
 
 			// Act appropiately depending on if the chunk data is compressed or not.
 			// For compressed chunks, we do LZSS decompression.
 			// For uncompressed chunks, we just memcpy() the chunk data out.
-			if(metadata[currentChunk].compressed) {
-				lzss::decompress(nullptr, &chunkReadBuffer[0], metadata[currentChunk].chunkDataSize, &chunkBuffer[0]);
+			auto decodeStart = std::chrono::steady_clock::now();
+			JMMT_TRACE_SCOPE("PakFile decode");
+			if(chunk.isCompressed()) {
+				lzss::decompress(nullptr, pChunkData, chunk.chunkDataSize, &chunkBuffer[0]);
 			} else {
-				memcpy(&chunkBuffer[0], &chunkReadBuffer[0], metadata[currentChunk].chunkUncompressedSize);
+				memcpy(&chunkBuffer[0], pChunkData, chunk.chunkUncompressedSize);
 			}
+
+			stats.recordChunkDecode(chunk.isCompressed(), decodedChunks[currentChunk], std::chrono::steady_clock::now() - decodeStart);
+			decodedChunks[currentChunk] = true;
+		}
+
+		bool isChunkBuffered(const ChunkMetadata& chunk) const {
+			return chunk.chunkDataOffset >= chunkReadBufferOffset
+				&& chunk.chunkDataOffset + chunk.chunkDataSize <= chunkReadBufferOffset + chunkReadBufferLength;
+		}
+
+		/// Reads the data of [firstChunk] into the read buffer, along with as many of the chunks
+		/// following it as are contiguous in the .pak file and fit in the buffer.
+		void fillReadBuffer(u32 firstChunk) {
+			JMMT_TRACE_SCOPE("PakFile I/O");
+			auto runOffset = chunks[firstChunk].chunkDataOffset;
+			auto runLength = chunks[firstChunk].chunkDataSize;
+			for(auto i = firstChunk + 1; i < chunks.size(); ++i) {
+				auto& chunk = chunks[i];
+				if(chunk.chunkDataOffset != runOffset + runLength || runLength + chunk.chunkDataSize > chunkReadBufferSize)
+					break;
+				runLength += chunk.chunkDataSize;
+			}
+
+			packageFileStream->seek(runOffset, mco::Stream::Begin);
+			chunkReadBufferOffset = runOffset;
+			chunkReadBufferLength = static_cast<u32>(packageFileStream->read(&chunkReadBuffer[0], runLength));
+			stats.recordDiskSeek();
+			stats.recordDiskRead(chunkReadBufferLength);
 		}
 
 		/// Helper to seek to a byte offset. seek() builds upon this
 		/// to implement the fully-featured random-access seeking.
 		void seekOffset(u32 offset) {
+			if(imageData) {
+				currentByteOffset = std::min(offset, metadata.fileSize);
+				return;
+			}
+
 			if(offset >= metadata.fileSize)
 				return;
 
@@ -160,25 +193,67 @@ namespace jmmt::fs {
 		}
 
 	   public:
-		explicit PakFile(const FileMetadata& metadata, mco::FileStream&& fileStream)
-			: metadata(metadata), packageFileStream(std::move(fileStream)) {
+		explicit PakFile(const FileMetadata& metadata, std::span<const ChunkMetadata> chunks, mco::FileStream&& fileStream, u32 maxReadSize, StatsCounters& stats, MemoryBudget& budget, Ref<PakPrefetcher> prefetcher)
+			: metadata(metadata), chunks(chunks), packageFileStream(std::move(fileStream)), stats(stats), prefetcher(std::move(prefetcher)), decodedChunks(chunks.size()) {
+			// Size the read buffer to fit as much of the file's data as we're allowed to read at once.
+			// It always needs to fit at least one chunk, though.
+			u32 totalDataSize = 0;
+			u32 largestChunkSize = 0;
+			for(auto& chunk : chunks) {
+				totalDataSize += chunk.chunkDataSize;
+				largestChunkSize = std::max(largestChunkSize, chunk.chunkDataSize);
+			}
+			chunkReadBufferSize = std::max(std::min(totalDataSize, maxReadSize), largestChunkSize);
+
+			// Reading ahead is optional. If the memory budget is spent, read one chunk at a time instead.
+			bufferReservation = budget.reserve(65536 + largestChunkSize, stats);
+			if(auto readAheadSize = chunkReadBufferSize - largestChunkSize; readAheadSize != 0) {
+				if(auto reservation = budget.tryReserve(readAheadSize, stats); reservation)
+					readAheadReservation = std::move(*reservation);
+				else
+					chunkReadBufferSize = largestChunkSize;
+			}
+
 			// Allocate work buffers.
 			chunkBuffer = std::make_unique<u8[]>(65536);
-			chunkReadBuffer = std::make_unique<u8[]>(65536);
+			chunkReadBuffer = std::make_unique<u8[]>(chunkReadBufferSize);
 
 			// Reset state and read the first chunk.
 			currentByteOffset = 0;
 			advanceToChunk(0);
 		}
 
+		/// Opens a file whose decompressed data is [imageData], in a package image.
+		explicit PakFile(const FileMetadata& metadata, std::span<const u8> imageData, StatsCounters& stats)
+			: metadata(metadata), imageData(imageData), stats(stats) {
+			currentByteOffset = 0;
+		}
+
 		i32 read(void* buffer, u32 count) {
+			auto start = std::chrono::steady_clock::now();
+			auto bytesRead = readImpl(buffer, count);
+			stats.recordFileRead(std::chrono::steady_clock::now() - start);
+			return bytesRead;
+		}
+
+		i32 readImpl(void* buffer, u32 count) {
 			if(currentByteOffset > metadata.fileSize)
 				return 0;
+
+			if(imageData) {
+				count = std::min(count, metadata.fileSize - currentByteOffset);
+				std::memcpy(buffer, imageData->data() + currentByteOffset, count);
+				currentByteOffset += count;
+				return count;
+			}
+			if(chunks.empty())
+				return 0;
+
 			u32 bytesRemaining = count;
 			auto outputBuffer = reinterpret_cast<u8*>(buffer);
 
 			while(bytesRemaining > 0) {
-				u32 currentChunkSize = metadata[currentChunk].chunkUncompressedSize;
+				u32 currentChunkSize = chunks[currentChunk].chunkUncompressedSize;
 				u32 bytesToRead = std::min(bytesRemaining, currentChunkSize - currentChunkByteOffset);
 				std::memcpy(outputBuffer + (count - bytesRemaining), chunkBuffer.get() + currentChunkByteOffset, bytesToRead);
 				bytesRemaining -= bytesToRead;
@@ -188,7 +263,7 @@ namespace jmmt::fs {
 				currentChunkByteOffset += bytesToRead;
 				currentByteOffset += bytesToRead;
 				if(currentChunkByteOffset >= currentChunkSize) {
-					if(currentChunk + 1 >= metadata.nChunks)
+					if(currentChunk + 1 >= chunks.size())
 						break;
 					advanceToChunk(currentChunk + 1);
 				}
@@ -230,6 +305,15 @@ namespace jmmt::fs {
 		u32 getFileSize() const {
 			return metadata.fileSize;
 		}
+
+		const FileMetadata& getMetadata() const {
+			return metadata;
+		}
+
+		/// Returns true if every chunk of this file has been decoded (so the whole file has been read).
+		bool isFullyDecoded() const {
+			return imageData || std::find(decodedChunks.begin(), decodedChunks.end(), false) == decodedChunks.end();
+		}
 	};
 
 	/// The max amount of files that can be open in the package filesystem.
@@ -239,109 +323,198 @@ namespace jmmt::fs {
 	/// Freelist for package files.
 	using FileFreeList = impl::FreeListAllocator<PakFile, MaxFileCount>;
 
-	/// Read except not really.
-	i64 temporaryRead(mco::Stream& stream, void* buffer, i64 len) {
-		// TODO: precondition is stream.isRandomAccess() == true
-		auto previouslyAt = stream.tell();
-		auto ret = stream.read(buffer, len);
-		stream.seek(previouslyAt, mco::Stream::Begin);
-		return ret;
-	}
-
-	std::string findStringHash(u32 nHash, const std::vector<std::string>& stringTable, const std::vector<u32>& stringTableHashes) {
-		for(auto i = 0; i < stringTable.size(); ++i) {
-			if(nHash == stringTableHashes[i]) {
-				return stringTable[i];
-				break;
-			}
-		}
-		return "";
-	}
-
 	class PakFileSystem::Impl {
 		Ref<GameFileSystem> gameFs;
 		PackageMetadata metadata;
 		std::string pakFilename;
 
-		structs::PackageGroupHeader packageGroup;
+		/// Statistics of this package. These are also recorded into the game filesystem's statistics.
+		/// Declared early, since nearly everything else records into them (even when being destroyed).
+		StatsCounters stats;
 
-		std::unordered_map<std::string, Unique<FileMetadata>> fileMetadata;
-		impl::Lazy<std::unordered_map<std::string, PakFileSystem::Metadata>> publicFileMetadata;
+		/// The game filesystem's memory budget, and the memory reserved from it for the index and public metadata.
+		MemoryBudget& budget;
+		MemoryReservation indexReservation;
+		MemoryReservation publicMetadataReservation;
+
+		/// The index of files in this package.
+		PakIndex index;
+		impl::Lazy<std::unordered_map<std::string_view, PakFileSystem::Metadata>> publicFileMetadata;
 
 		/// Open files.
 		FileFreeList openFiles;
 
-		// string table
-		std::vector<std::string> stringTable;
-		std::vector<u32> stringTableHashes;
+		/// True once the string table has been read (or adopted from an index cache).
+		bool stringTableLoaded = false;
+
+		/// The largest read done at once when reading a run of contiguous chunks.
+		u32 maxReadSize = PakFileSystem::DefaultMaxReadSize;
+
+		/// Indices of files in the index, sorted by name and by data offset respectively.
+		/// Built the first time a file enumeration asks for that order.
+		std::vector<u32> filesByName;
+		std::vector<u32> filesByOffset;
+
+		/// The identity of the package, for validating index caches and package images.
+		/// Only computed if either is enabled.
+		std::optional<PakIndexIdentity> identity;
+
+		/// The decompressed image of this package, if image caching is enabled and there is a valid one.
+		Unique<PakImage> image;
+
+		/// Name hashes of the files which have been read in full. See [isFullyReadImpl].
+		std::unordered_set<u32> fullyReadFiles;
+
+		/// A read recorded by an access trace. Names are only resolved once the trace is stopped.
+		struct RecordedRead {
+			u32 nameHash;
+			u32 offset;
+			u32 length;
+			std::chrono::nanoseconds timestamp;
+		};
+
+		/// The access trace being recorded, if any.
+		bool recordingAccessTrace = false;
+		std::chrono::steady_clock::time_point accessTraceStart;
+		std::vector<RecordedRead> recordedReads;
+
+		/// Prefetches the chunks of the prefetch plan, if there is one. Open files share it.
+		Ref<PakPrefetcher> prefetcher;
 
 	   public:
-		Impl(Ref<GameFileSystem> fs, const PackageMetadata& metadata, const std::string& fileName)
-			: gameFs(fs), metadata(metadata), pakFilename(fileName) {
+		Impl(Ref<GameFileSystem> fs, StatsCounters& gameFsStats, MemoryBudget& budget, const PackageMetadata& metadata, const std::string& fileName)
+			: gameFs(fs), metadata(metadata), pakFilename(fileName), stats(&gameFsStats), budget(budget) {
 		}
 
-		Error processPackageChunks(u8* pChunkData, usize chunkSize, const std::vector<std::string>& stringTable, const std::vector<u32>& stringTableHashes) {
-			auto chunkStream = mco::MemoryStream(pChunkData, chunkSize);
-			std::string currentFileName;
+		/// Reserves memory for the index as it is now. Called whenever the index grows.
+		void updateIndexReservation() {
+			indexReservation.release();
+			indexReservation = budget.reserve(index.getMemorySize(), stats);
+		}
 
-			while(!chunkStream.hasEnded()) {
-				// Read the chunk id and seek back so we can figure out what chunk it is.
-				FourCC chunkId {};
-				if(auto n = temporaryRead(chunkStream, &chunkId, sizeof(chunkId)); n != sizeof(chunkId))
-					return PakFileSystem::InitProcessChunksFailure;
+		/// Finds the metadata of the file at [path]. Lazily initialized packages build it the first time it's
+		/// looked up, so the index's reservation is brought up to date whenever that grows the index.
+		const FileMetadata* findFile(std::string_view path) {
+			auto* pFileMetadata = index.findFile(path);
+			if(index.isLazy() && index.getMemorySize() != indexReservation.getSize())
+				updateIndexReservation();
+			return pFileMetadata;
+		}
 
-				// Process each chunk type.
-				switch(chunkId) {
-					case structs::PackageGroupHeader::MAGIC: {
-						// might be nice to provide this?
-						structs::PackageGroupHeader groupHeader {};
-						if(auto n = chunkStream.read(&groupHeader, sizeof(groupHeader)); n != sizeof(groupHeader))
-							return PakFileSystem::InitProcessChunksFailure;
-						std::memcpy(&this->packageGroup, &groupHeader, sizeof(groupHeader));
-					} break;
-
-					case structs::PackageFileHeader::MAGIC: {
-						structs::PackageFileHeader pfil {};
-						if(auto n = chunkStream.read(&pfil, sizeof(pfil)); n != sizeof(pfil))
-							return PakFileSystem::InitProcessChunksFailure;
-
-						if(pfil.chunkNumber == 0) {
-							// Find the filename in the string table hashes.
-							currentFileName = findStringHash(pfil.indexName, stringTable, stringTableHashes);
-
-							// Create metadata for this file.
-							fileMetadata.emplace(currentFileName, std::make_unique<FileMetadata>(pfil.chunkCount));
-
-							// Fill in metadata.
-							fileMetadata[currentFileName]->sourceName = findStringHash(pfil.indexSourceName, stringTable, stringTableHashes);
-							fileMetadata[currentFileName]->sourceConvertName = findStringHash(pfil.indexSourceConvertName, stringTable, stringTableHashes);
-							fileMetadata[currentFileName]->sourceCompressName = findStringHash(pfil.indexSourceCompressName, stringTable, stringTableHashes);
-							fileMetadata[currentFileName]->typeName = findStringHash(pfil.indexType, stringTable, stringTableHashes);
-							fileMetadata[currentFileName]->fileSize = pfil.totalFileSize;
-							fileMetadata[currentFileName]->dateStamp = pfil.dayCreated;
-						}
-
-						// Fill in the chunk in the file metadata.
-						(*fileMetadata[currentFileName])[pfil.chunkNumber] = {
-							.chunkByteOffset = pfil.chunkOffset,
-							.chunkDataOffset = pfil.dataOffset,
-							.chunkDataSize = pfil.dataSize,
-							.chunkUncompressedSize = pfil.chunkSize,
-							.compressed = pfil.chunkSize != pfil.dataSize
-						};
-					} break;
-
-					default:
-						// Invalid type, just fail.
-						return PakFileSystem::InitProcessChunksFailure;
-				}
-			}
+		/// Returns the path of this package's cache file with the given [extension] in [directory].
+		std::filesystem::path getCachePath(const std::filesystem::path& directory, const std::filesystem::path& pakPath, std::string_view extension) const {
+			// Key the cache name by the package's full path too, so that a cache directory
+			// can be shared between multiple game filesystems.
+			auto cacheName = pakFilename;
+			for(auto& c : cacheName)
+				if(c == '/' || c == '\\')
+					c = '_';
+			auto absolutePakPath = std::filesystem::absolute(pakPath).string();
+			return directory / std::format("{}-{:08X}.{}", cacheName, jmmt::hashStringCase(absolutePakPath), extension);
+		}
+
+		/// Computes the identity of the package, for validating index caches and package images.
+		/// Only the start of the header block is read.
+		bool computeIdentity(mco::FileStream& file, const std::filesystem::path& pakPath) {
+			u8 headerStart[HeaderChecksumSize];
+			auto headerStartSize = std::min<usize>(HeaderChecksumSize, metadata.chunkDataSize);
+			file.seek(metadata.chunkStartOffset, mco::Stream::Begin);
+			if(auto n = file.read(&headerStart[0], headerStartSize); n != headerStartSize)
+				return false;
+
+			identity = PakIndexIdentity {
+				.pakSize = static_cast<u64>(std::filesystem::file_size(pakPath)),
+				.pakModifiedTime = static_cast<i64>(std::filesystem::last_write_time(pakPath).time_since_epoch().count()),
+				.headerChecksum = computeHeaderChecksum({ &headerStart[0], headerStartSize }),
+				.chunkStartOffset = metadata.chunkStartOffset,
+				.chunkDataSize = metadata.chunkDataSize,
+				.nrPackageFiles = metadata.nrPackageFiles
+			};
+			return true;
+		}
+
+		/// Tries to adopt an existing index cache for this package. If the cache is valid, nothing else needs to be parsed.
+		bool tryAdoptIndexCache(const std::filesystem::path& cachePath) {
+			auto mapping = impl::MappedFile::open(cachePath);
+			if(!mapping)
+				return false;
 
+			return index.adoptCache(std::move(mapping), *identity);
+		}
+
+		/// Reads the string table, which starts at the current position of [file].
+		Error readStringTable(mco::Stream& file) {
+			u32 nStringTableEntries {};
+			if(auto n = file.read(&nStringTableEntries, sizeof(u32)); n != sizeof(u32))
+				return PakFileSystem::InitReadStringTableFailure;
+
+			std::vector<std::string> stringTable;
+			stringTable.reserve(nStringTableEntries);
+			for(u32 i = 0; i < nStringTableEntries; ++i)
+				stringTable.push_back(file.readString());
+			index.setStringTable(std::move(stringTable));
+			stringTableLoaded = true;
 			return PakFileSystem::Success;
 		}
 
-		Error initializeImpl() {
+		/// Reads the string table if it hasn't been already. The string table of lazily initialized
+		/// packages is only read once something needs the names of files.
+		bool ensureStringTable() {
+			if(stringTableLoaded)
+				return true;
+
+			try {
+				auto file = gameFs->openFile(pakFilename, GameFileSystem::FileData);
+				file.seek(metadata.chunkStartOffset + metadata.chunkDataSize, mco::Stream::Begin);
+				return readStringTable(file) == PakFileSystem::Success;
+			} catch(std::system_error& err) {
+				return false;
+			}
+		}
+
+		/// Fully builds the index of a lazily initialized package.
+		bool ensureFullIndex() {
+			if(!index.isLazy())
+				return true;
+			if(!ensureStringTable() || !index.buildLazyIndex())
+				return false;
+			updateIndexReservation();
+			return true;
+		}
+
+		Error initializeImpl(InitMode mode) {
 			auto file = gameFs->openFile(pakFilename, GameFileSystem::FileData);
+
+			// Caches are only used for the exact package they were built from.
+			std::filesystem::path pakPath;
+			if(!gameFs->getIndexCachePath().empty() || !gameFs->getImageCachePath().empty()) {
+				pakPath = gameFs->getFilePath(pakFilename, GameFileSystem::FileData);
+				if(!computeIdentity(file, pakPath))
+					return PakFileSystem::InitReadChunkFailure;
+			}
+
+			// If image caching is enabled, map this package's image, if there is one.
+			if(!gameFs->getImageCachePath().empty()) {
+				image = PakImage::open(getCachePath(gameFs->getImageCachePath(), pakPath, "jmimg"), *identity);
+				stats.recordImageCache(image != nullptr);
+			}
+
+			// If index caching is enabled, try to use a previously saved index first.
+			std::filesystem::path cachePath;
+			if(!gameFs->getIndexCachePath().empty()) {
+				cachePath = getCachePath(gameFs->getIndexCachePath(), pakPath, "jmidx");
+				auto adopted = tryAdoptIndexCache(cachePath);
+				stats.recordIndexCache(adopted);
+				if(adopted) {
+					stringTableLoaded = true;
+					updateIndexReservation();
+					setupPublicMetadata();
+					return PakFileSystem::Success;
+				}
+			}
+
+			// Lazy indices keep the header buffer, so its memory is counted as part of the index from then on.
+			auto headerReservation = budget.reserve(metadata.chunkDataSize, stats);
 			Unique<u8[]> mHeaderBuffer = std::make_unique<u8[]>(metadata.chunkDataSize);
 
 			// Read the package chunk data into a data buffer for later processing.
@@ -351,62 +524,351 @@ namespace jmmt::fs {
 				// which would imply the game could not use this file either.
 				return PakFileSystem::InitReadChunkFailure;
 			}
+			stats.recordDiskSeek();
+			stats.recordDiskRead(metadata.chunkDataSize);
 
-			u32 nStringTableEntries {};
+			// Lazily initialized packages stop here. Files are looked up by the hash of their name,
+			// so neither the string table or the metadata of any file is needed until it's used.
+			if(mode == PakFileSystem::InitLazy) {
+				if(!index.processChunksLazy(std::move(mHeaderBuffer), metadata.chunkDataSize))
+					return PakFileSystem::InitProcessChunksFailure;
+				headerReservation.release();
+				updateIndexReservation();
+				setupPublicMetadata();
+				return PakFileSystem::Success;
+			}
 
 			// Next, read the string table. This will be used for filename resolution.
-			if(auto n = file.read(&nStringTableEntries, sizeof(u32)); n != sizeof(u32))
-				return PakFileSystem::InitReadStringTableFailure;
-
-			stringTable.reserve(nStringTableEntries);
-			stringTableHashes.resize(nStringTableEntries);
-			for(auto i = 0; i < nStringTableEntries; ++i) {
-				stringTable.push_back(file.readString());
-				stringTableHashes[i] = jmmt::hashString(stringTable[i]);
+			if(auto error = readStringTable(file); error != PakFileSystem::Success)
+				return error;
+
+			// Now process the chunk data we read in place.
+			if(!index.processChunks({ mHeaderBuffer.get(), metadata.chunkDataSize }))
+				return PakFileSystem::InitProcessChunksFailure;
+
+			// Save the index so later opens of this package can skip all of the above.
+			// This is only an optimization, so failing to write the cache isn't an error.
+			if(!cachePath.empty()) {
+				std::error_code ec;
+				std::filesystem::create_directories(gameFs->getIndexCachePath(), ec);
+				index.writeCache(cachePath, *identity);
 			}
 
-			// Now process the chunk data we read. If this fails, we also propegate the error.
-			if(auto processRet = processPackageChunks(mHeaderBuffer.get(), metadata.chunkDataSize, stringTable, stringTableHashes); processRet != PakFileSystem::Success)
-				return processRet;
+			headerReservation.release();
+			updateIndexReservation();
+			setupPublicMetadata();
+			return PakFileSystem::Success;
+		}
 
+		void setupPublicMetadata() {
 			// Setup a callback for the lazily computed public file metadata to create it
 			// once a api user actually bothers to call getMetadata().
 			publicFileMetadata.setLambda([&]() {
-				std::unordered_map<std::string, PakFileSystem::Metadata> meta;
-				for(auto& [k, v] : fileMetadata) {
-					meta[k] = {
-						.sourceName = (*v).sourceName,
-						.sourceConvertName = (*v).sourceConvertName,
-						.sourceCompressName = (*v).sourceCompressName,
-						.fileSize = (*v).fileSize,
-						.dateStamp = (*v).dateStamp
+				std::unordered_map<std::string_view, PakFileSystem::Metadata> meta;
+
+				// Metadata of every file is needed, so lazily initialized packages need to be fully indexed.
+				if(!ensureFullIndex())
+					return meta;
+
+				for(auto& file : index.getFiles()) {
+					meta[index.getString(file.name)] = {
+						.sourceName = index.getString(file.sourceName),
+						.sourceConvertName = index.getString(file.sourceConvertName),
+						.sourceCompressName = index.getString(file.sourceCompressName),
+						.typeName = index.getString(file.typeName),
+						.fileSize = file.fileSize,
+						.dateStamp = file.dateStamp
 					};
 				}
+
+				// Map nodes are counted as their contents plus a next pointer and the cached hash.
+				constexpr usize NodeSize = sizeof(std::pair<const std::string_view, PakFileSystem::Metadata>) + 2 * sizeof(void*);
+				publicMetadataReservation = budget.reserve(meta.size() * NodeSize + meta.bucket_count() * sizeof(void*), stats);
 				return meta;
 			});
-
-			return PakFileSystem::Success;
 		}
 
-		const std::unordered_map<std::string, PakFileSystem::Metadata>& getMetadataImpl() {
+		const std::unordered_map<std::string_view, PakFileSystem::Metadata>& getMetadataImpl() {
 			return publicFileMetadata.get();
 		}
 
+		Stats getStatsImpl() const {
+			return stats.snapshot();
+		}
+
+		void setMaxReadSizeImpl(u32 size) {
+			maxReadSize = size;
+		}
+
+		u32 getMaxReadSizeImpl() const {
+			return maxReadSize;
+		}
+
+		/// Returns the offset in the .pak file where [file]'s first chunk starts.
+		u32 getDataOffset(const FileMetadata& file) const {
+			if(auto chunks = index.getChunks(file); !chunks.empty())
+				return chunks[0].chunkDataOffset;
+			return 0;
+		}
+
+		FileEntry getFileEntryImpl(u32 fileIndex) const {
+			auto& file = index.getFiles()[fileIndex];
+			return {
+				.name = index.getString(file.name),
+				.metadata = {
+				.sourceName = index.getString(file.sourceName),
+				.sourceConvertName = index.getString(file.sourceConvertName),
+				.sourceCompressName = index.getString(file.sourceCompressName),
+				.typeName = index.getString(file.typeName),
+				.fileSize = file.fileSize,
+				.dateStamp = file.dateStamp },
+				.dataOffset = getDataOffset(file)
+			};
+		}
+
+		/// Returns the file order for [order], building it if needed.
+		/// A null pointer means the index's own order.
+		const u32* getFileOrder(SortOrder order) {
+			auto files = index.getFiles();
+
+			auto buildOrder = [&](std::vector<u32>& fileOrder, auto&& less) {
+				if(fileOrder.size() != files.size()) {
+					fileOrder.resize(files.size());
+					for(u32 i = 0; i < fileOrder.size(); ++i)
+						fileOrder[i] = i;
+					std::stable_sort(fileOrder.begin(), fileOrder.end(), [&](u32 lhs, u32 rhs) {
+						return less(files[lhs], files[rhs]);
+					});
+				}
+				return fileOrder.data();
+			};
+
+			switch(order) {
+				case PakFileSystem::SortByName:
+					return buildOrder(filesByName, [&](const FileMetadata& lhs, const FileMetadata& rhs) {
+						return index.getString(lhs.name) < index.getString(rhs.name);
+					});
+				case PakFileSystem::SortByOffset:
+					return buildOrder(filesByOffset, [&](const FileMetadata& lhs, const FileMetadata& rhs) {
+						return getDataOffset(lhs) < getDataOffset(rhs);
+					});
+				default:
+					return nullptr;
+			}
+		}
+
+		/// Returns the pieces of a [FileRange] over this package's files, in [order].
+		std::pair<const u32*, u32> enumerateFilesImpl(SortOrder order) {
+			// Every file is needed, so lazily initialized packages need to be fully indexed.
+			if(!ensureFullIndex())
+				return { nullptr, 0 };
+
+			return { getFileOrder(order), static_cast<u32>(index.getFiles().size()) };
+		}
+
+		std::vector<u32> getFileNameHashesImpl() const {
+			std::vector<u32> hashes;
+			index.getFileNameHashes(hashes);
+			return hashes;
+		}
+
+		std::optional<PakFileSystem::Metadata> getFileMetadataImpl(std::string_view path) {
+			// Strings are needed for metadata.
+			ensureStringTable();
+
+			if(auto* pFileMetadata = findFile(path); pFileMetadata) {
+				return PakFileSystem::Metadata {
+					.sourceName = index.getString(pFileMetadata->sourceName),
+					.sourceConvertName = index.getString(pFileMetadata->sourceConvertName),
+					.sourceCompressName = index.getString(pFileMetadata->sourceCompressName),
+					.typeName = index.getString(pFileMetadata->typeName),
+					.fileSize = pFileMetadata->fileSize,
+					.dateStamp = pFileMetadata->dateStamp
+				};
+			}
+			return std::nullopt;
+		}
+
 		FileHandle fileOpenImpl(std::string_view path) {
-			if(auto it = fileMetadata.find(std::string(path)); it != fileMetadata.end()) {
+			if(auto* pFileMetadata = findFile(path); pFileMetadata) {
+				stats.recordFileOpen();
+
+				// Files in the package image are read straight from it; the .pak file isn't even opened.
+				if(image)
+					if(auto imageData = image->findFile(pFileMetadata->nameHash); imageData)
+						return openFiles.allocateObject(*pFileMetadata, *imageData, stats);
+
+				// A corrupt or stale index cache can leave a file without (all of) its chunks.
+				// Refuse to open it, instead of reading past the chunks it does have.
+				auto chunks = index.getChunks(*pFileMetadata);
+				if(chunks.size() != pFileMetadata->nChunks || (chunks.empty() && pFileMetadata->fileSize != 0))
+					return -1;
+
 				auto file = gameFs->openFile(pakFilename, GameFileSystem::FileData);
-				return openFiles.allocateObject(*it->second, std::move(file));
+				return openFiles.allocateObject(*pFileMetadata, chunks, std::move(file), maxReadSize, stats, budget, prefetcher);
 			}
 			return -1;
 		}
 
+		std::optional<std::span<const u8>> getImageFileDataImpl(std::string_view path) {
+			if(!image)
+				return std::nullopt;
+			if(auto* pFileMetadata = findFile(path); pFileMetadata)
+				return image->findFile(pFileMetadata->nameHash);
+			return std::nullopt;
+		}
+
+		bool hasImageImpl() const {
+			return image != nullptr;
+		}
+
+		bool isFullyReadImpl() const {
+			auto fileCount = index.getFileCount();
+			return !image && fileCount != 0 && fullyReadFiles.size() >= fileCount;
+		}
+
+		/// Decodes the whole of [file] into [data], reading its chunks from [pakFile].
+		bool decodeWholeFile(mco::FileStream& pakFile, const FileMetadata& file, std::span<u8> data, std::vector<u8>& chunkData, u8* pChunkBuffer) {
+			for(auto& chunk : index.getChunks(file)) {
+				if(chunk.chunkByteOffset > data.size() || data.size() - chunk.chunkByteOffset < chunk.chunkUncompressedSize || chunk.chunkUncompressedSize > 65536)
+					return false;
+
+				chunkData.resize(chunk.chunkDataSize);
+				pakFile.seek(chunk.chunkDataOffset, mco::Stream::Begin);
+				if(pakFile.read(chunkData.data(), chunkData.size()) != chunkData.size())
+					return false;
+				stats.recordDiskSeek();
+				stats.recordDiskRead(chunk.chunkDataSize);
+
+				auto decodeStart = std::chrono::steady_clock::now();
+				if(chunk.isCompressed()) {
+					lzss::decompress(nullptr, chunkData.data(), chunk.chunkDataSize, pChunkBuffer);
+					std::memcpy(&data[chunk.chunkByteOffset], pChunkBuffer, chunk.chunkUncompressedSize);
+				} else {
+					std::memcpy(&data[chunk.chunkByteOffset], chunkData.data(), chunk.chunkUncompressedSize);
+				}
+				stats.recordChunkDecode(chunk.isCompressed(), false, std::chrono::steady_clock::now() - decodeStart);
+			}
+			return true;
+		}
+
+		bool writeImageCacheImpl() {
+			JMMT_TRACE_SCOPE("PakFileSystem::writeImageCache");
+			if(gameFs->getImageCachePath().empty())
+				return false;
+
+			// A package served from an image already has one. Replacing it would unmap the image,
+			// which open files and views from [getImageFileDataImpl] point into.
+			if(image)
+				return true;
+
+			if(!ensureFullIndex())
+				return false;
+
+			try {
+				auto pakFile = gameFs->openFile(pakFilename, GameFileSystem::FileData);
+				auto pakPath = gameFs->getFilePath(pakFilename, GameFileSystem::FileData);
+				if(!identity && !computeIdentity(pakFile, pakPath))
+					return false;
+
+				// Decode files in the order their data is in the .pak file, so that it's read sequentially.
+				auto files = index.getFiles();
+				auto* pOrder = getFileOrder(PakFileSystem::SortByOffset);
+				std::vector<const FileMetadata*> orderedFiles(files.size());
+				for(usize i = 0; i < files.size(); ++i)
+					orderedFiles[i] = &files[pOrder[i]];
+
+				std::vector<u8> chunkData;
+				auto chunkBuffer = std::make_unique<u8[]>(65536);
+				auto decodeFile = [&](const FileMetadata& file, std::span<u8> data) {
+					return decodeWholeFile(pakFile, file, data, chunkData, chunkBuffer.get());
+				};
+
+				std::error_code ec;
+				std::filesystem::create_directories(gameFs->getImageCachePath(), ec);
+				auto imagePath = getCachePath(gameFs->getImageCachePath(), pakPath, "jmimg");
+				if(!PakImage::write(imagePath, *identity, orderedFiles, decodeFile))
+					return false;
+
+				// Serve files opened from now on from the new image.
+				image = PakImage::open(imagePath, *identity);
+				return image != nullptr;
+			} catch(std::system_error& err) {
+				return false;
+			}
+		}
+
 		i32 fileReadImpl(FileHandle file, void* pBuffer, u32 size) {
 			if(auto filePtr = openFiles.dereferenceHandle(file); filePtr) {
-				return filePtr->read(pBuffer, size);
+				auto offset = filePtr->tell();
+				auto bytesRead = filePtr->read(pBuffer, size);
+				if(recordingAccessTrace && bytesRead > 0)
+					recordedReads.push_back({ .nameHash = filePtr->getMetadata().nameHash,
+											  .offset = offset,
+											  .length = static_cast<u32>(bytesRead),
+											  .timestamp = std::chrono::steady_clock::now() - accessTraceStart });
+				return bytesRead;
 			}
 			return -1;
 		}
 
+		void startAccessTraceImpl() {
+			recordedReads.clear();
+			recordingAccessTrace = true;
+			accessTraceStart = std::chrono::steady_clock::now();
+		}
+
+		AccessTrace stopAccessTraceImpl() {
+			recordingAccessTrace = false;
+
+			AccessTrace trace;
+			if(!ensureFullIndex())
+				return trace;
+
+			std::unordered_map<u32, std::string_view> fileNames;
+			for(auto& file : index.getFiles())
+				fileNames.emplace(file.nameHash, index.getString(file.name));
+
+			trace.entries.reserve(recordedReads.size());
+			for(auto& read : recordedReads)
+				trace.entries.push_back({ .fileName = std::string(fileNames[read.nameHash]), .offset = read.offset, .length = read.length, .timestamp = read.timestamp });
+			recordedReads.clear();
+			return trace;
+		}
+
+		void setPrefetchPlanImpl(const AccessTrace& trace, u64 maxPrefetchBytes) {
+			prefetcher.reset();
+
+			// Files in the package image don't need decoding, so there's nothing to prefetch.
+			if(image)
+				return;
+
+			// Turn the trace into the chunks each read touched, in order.
+			std::vector<ChunkMetadata> plan;
+			for(auto& entry : trace.entries) {
+				auto* pFileMetadata = findFile(entry.fileName);
+				if(!pFileMetadata)
+					continue;
+
+				for(auto& chunk : index.getChunks(*pFileMetadata))
+					if(chunk.chunkByteOffset < entry.offset + entry.length && entry.offset < chunk.chunkByteOffset + chunk.chunkUncompressedSize)
+						plan.push_back(chunk);
+			}
+
+			if(plan.empty())
+				return;
+
+			try {
+				prefetcher = std::make_shared<PakPrefetcher>(gameFs->openFile(pakFilename, GameFileSystem::FileData), std::move(plan), maxPrefetchBytes, stats, budget);
+			} catch(std::system_error& err) {
+				// Prefetching is only an optimization.
+			}
+		}
+
+		void clearPrefetchPlanImpl() {
+			prefetcher.reset();
+		}
+
 		i32 fileSeekImpl(FileHandle file, i32 offset, SeekOrigin origin) {
 			if(auto filePtr = openFiles.dereferenceHandle(file); filePtr) {
 				return filePtr->seek(offset, origin);
@@ -429,24 +891,66 @@ namespace jmmt::fs {
 		}
 
 		void fileCloseImpl(FileHandle file) {
+			// Keep track of which files have been read in full, so users know when writing an image
+			// is worthwhile. Writing one decodes the whole package, so it's never done implicitly here.
+			if(auto filePtr = openFiles.dereferenceHandle(file); filePtr && !image && filePtr->isFullyDecoded())
+				fullyReadFiles.insert(filePtr->getMetadata().nameHash);
+
 			openFiles.freeObject(file);
 		}
 	};
 
 	PakFileSystem::PakFileSystem(Ref<GameFileSystem> fs, const PackageMetadata& metadata, const std::string& fileName)
-		: impl(std::make_unique<Impl>(fs, metadata, fileName)) {
+		: impl(std::make_unique<Impl>(fs, fs->getStatsCounters(), fs->getMemoryBudget(), metadata, fileName)) {
 	}
 
 	PakFileSystem::~PakFileSystem() = default;
 
-	PakFileSystem::Error PakFileSystem::initialize() {
-		return impl->initializeImpl();
+	PakFileSystem::Error PakFileSystem::initialize(InitMode mode) {
+		JMMT_TRACE_SCOPE("PakFileSystem::initialize");
+		auto start = std::chrono::steady_clock::now();
+		auto error = impl->initializeImpl(mode);
+		initializationTime = std::chrono::steady_clock::now() - start;
+		return error;
 	}
 
-	const std::unordered_map<std::string, PakFileSystem::Metadata>& PakFileSystem::getMetadata() {
+	std::chrono::nanoseconds PakFileSystem::getInitializationTime() const {
+		return initializationTime;
+	}
+
+	const std::unordered_map<std::string_view, PakFileSystem::Metadata>& PakFileSystem::getMetadata() {
 		return impl->getMetadataImpl();
 	}
 
+	Stats PakFileSystem::getStats() const {
+		return impl->getStatsImpl();
+	}
+
+	void PakFileSystem::setMaxReadSize(u32 size) {
+		impl->setMaxReadSizeImpl(size);
+	}
+
+	u32 PakFileSystem::getMaxReadSize() const {
+		return impl->getMaxReadSizeImpl();
+	}
+
+	PakFileSystem::FileRange PakFileSystem::enumerateFiles(SortOrder order) {
+		auto [pOrder, count] = impl->enumerateFilesImpl(order);
+		return FileRange(impl.get(), pOrder, count);
+	}
+
+	PakFileSystem::FileEntry PakFileSystem::FileIterator::operator*() const {
+		return pImpl->getFileEntryImpl(pOrder ? pOrder[position] : position);
+	}
+
+	std::optional<PakFileSystem::Metadata> PakFileSystem::getFileMetadata(const std::string_view path) {
+		return impl->getFileMetadataImpl(path);
+	}
+
+	std::vector<u32> PakFileSystem::getFileNameHashes() const {
+		return impl->getFileNameHashesImpl();
+	}
+
 	PakFileSystem::FileHandle PakFileSystem::fileOpen(const std::string_view path) {
 		return impl->fileOpenImpl(path);
 	}
@@ -471,4 +975,52 @@ namespace jmmt::fs {
 		return impl->fileCloseImpl(file);
 	}
 
+	std::optional<std::vector<u8>> PakFileSystem::readWholeFile(const std::string_view path) {
+		if(auto imageData = impl->getImageFileDataImpl(path); imageData)
+			return std::vector<u8>(imageData->begin(), imageData->end());
+
+		auto handle = impl->fileOpenImpl(path);
+		if(handle < 0)
+			return std::nullopt;
+
+		std::vector<u8> data(impl->fileGetSizeImpl(handle));
+		auto bytesRead = impl->fileReadImpl(handle, data.data(), static_cast<u32>(data.size()));
+		impl->fileCloseImpl(handle);
+		if(bytesRead != static_cast<i32>(data.size()))
+			return std::nullopt;
+		return data;
+	}
+
+	std::optional<std::span<const u8>> PakFileSystem::getImageFileData(const std::string_view path) {
+		return impl->getImageFileDataImpl(path);
+	}
+
+	bool PakFileSystem::hasImage() const {
+		return impl->hasImageImpl();
+	}
+
+	bool PakFileSystem::isFullyRead() const {
+		return impl->isFullyReadImpl();
+	}
+
+	bool PakFileSystem::writeImageCache() {
+		return impl->writeImageCacheImpl();
+	}
+
+	void PakFileSystem::startAccessTrace() {
+		impl->startAccessTraceImpl();
+	}
+
+	AccessTrace PakFileSystem::stopAccessTrace() {
+		return impl->stopAccessTraceImpl();
+	}
+
+	void PakFileSystem::setPrefetchPlan(const AccessTrace& trace, u64 maxPrefetchBytes) {
+		impl->setPrefetchPlanImpl(trace, maxPrefetchBytes);
+	}
+
+	void PakFileSystem::clearPrefetchPlan() {
+		impl->clearPrefetchPlanImpl();
+	}
+
 } // namespace jmmt::fs
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <libjmmt/impl/replace_file.hpp>
+#include <mco/io/file_stream.hpp>
+#include <vector>
+
+#include "pak_image.hpp"
+
+namespace jmmt::fs {
+
+	namespace {
+		/// Every file's data starts on this alignment, so that users given a pointer
+		/// straight into the image can load from it with aligned vector loads.
+		constexpr u64 ImageDataAlignment = 16;
+
+		constexpr u64 alignImageData(u64 offset) {
+			return (offset + ImageDataAlignment - 1) & ~(ImageDataAlignment - 1);
+		}
+	} // namespace
+
+	Unique<PakImage> PakImage::open(const std::filesystem::path& path, const PakIndexIdentity& identity) {
+		auto mapping = impl::MappedFile::open(path);
+		if(!mapping)
+			return nullptr;
+
+		auto data = mapping->getSpan();
+		auto* pHeader = viewStructure<PakImageHeader>(data, 0);
+		if(!pHeader || pHeader->magic != PakImageHeader::MAGIC || pHeader->version != PakImageHeader::VERSION)
+			return nullptr;
+
+		// Don't use a stale image.
+		if(pHeader->identity != identity)
+			return nullptr;
+
+		if(pHeader->entriesOffset % alignof(PakImageEntry) != 0 || pHeader->entriesOffset > data.size()
+		   || (data.size() - pHeader->entriesOffset) / sizeof(PakImageEntry) < pHeader->fileCount)
+			return nullptr;
+		std::span<const PakImageEntry> entries(reinterpret_cast<const PakImageEntry*>(data.data() + pHeader->entriesOffset), pHeader->fileCount);
+
+		// Check every entry once here, so that lookups don't have to.
+		for(auto& entry : entries)
+			if(entry.offset > data.size() || data.size() - entry.offset < entry.size)
+				return nullptr;
+
+		auto image = Unique<PakImage>(new PakImage());
+		image->entries = entries;
+		image->mapping = std::move(mapping);
+		return image;
+	}
+
+	bool PakImage::write(const std::filesystem::path& path, const PakIndexIdentity& identity, std::span<const FileMetadata* const> files, const FileDecoder& decodeFile) {
+		PakImageHeader header {
+			.magic = PakImageHeader::MAGIC,
+			.version = PakImageHeader::VERSION,
+			.identity = identity,
+			.fileCount = static_cast<u32>(files.size()),
+			.entriesOffset = static_cast<u32>(alignImageData(sizeof(PakImageHeader)))
+		};
+
+		std::vector<PakImageEntry> entries;
+		entries.reserve(files.size());
+
+		return impl::writeFileReplacing(path, [&](mco::FileStream& stream) {
+			auto writePadded = [&](u64 offset, const void* pData, usize size) {
+				static constexpr u8 padding[ImageDataAlignment] {};
+				auto padSize = offset - static_cast<u64>(stream.tell());
+				if(stream.write(&padding[0], padSize) != padSize)
+					return false;
+				return stream.write(pData, size) == size;
+			};
+
+			// Leave room for the header and entries, which are written once every file's offset is known.
+			u64 dataOffset = alignImageData(header.entriesOffset + files.size() * sizeof(PakImageEntry));
+			std::vector<u8> placeholder(dataOffset);
+			bool succeeded = stream.write(placeholder.data(), placeholder.size()) == placeholder.size();
+
+			std::vector<u8> data;
+			for(usize i = 0; succeeded && i < files.size(); ++i) {
+				auto& file = *files[i];
+				data.resize(file.fileSize);
+				if(!decodeFile(file, data)) {
+					succeeded = false;
+					break;
+				}
+
+				entries.push_back({ .nameHash = file.nameHash, .size = file.fileSize, .offset = dataOffset });
+				succeeded = writePadded(dataOffset, data.data(), data.size());
+				dataOffset = alignImageData(dataOffset + data.size());
+			}
+
+			// Entries are looked up by binary search.
+			std::sort(entries.begin(), entries.end(), [](const PakImageEntry& lhs, const PakImageEntry& rhs) {
+				return lhs.nameHash < rhs.nameHash;
+			});
+
+			if(!succeeded)
+				return false;
+
+			stream.seek(0, mco::Stream::Begin);
+			return stream.write(&header, sizeof(header)) == sizeof(header)
+				&& writePadded(header.entriesOffset, entries.data(), entries.size() * sizeof(PakImageEntry));
+		});
+	}
+
+	std::optional<std::span<const u8>> PakImage::findFile(u32 nameHash) const {
+		auto it = std::lower_bound(entries.begin(), entries.end(), nameHash, [](const PakImageEntry& entry, u32 hash) {
+			return entry.nameHash < hash;
+		});
+		if(it == entries.end() || it->nameHash != nameHash)
+			return std::nullopt;
+		return mapping->getSpan().subspan(it->offset, it->size);
+	}
+
+} // namespace jmmt::fs
@@ -0,0 +1,69 @@
+//! Decompressed package images. This is an implementation detail of the package filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <jmmt/impl/mapped_file.hpp>
+#include <mco/base_types.hpp>
+#include <optional>
+#include <span>
+
+#include "pak_index.hpp"
+
+namespace jmmt::fs {
+
+	/// Header of a package image file. A package image holds the decompressed data of every file in a
+	/// package, so that files can be read straight out of a mapping of it. The header is followed by the
+	/// entry table, and then the data of every file, at the offsets given in the header and entries.
+	struct PakImageHeader {
+		constexpr static auto MAGIC = FourCCGenerator<>::generate<"JMIM">();
+		constexpr static u32 VERSION = 1;
+
+		FourCC magic;
+		u32 version;
+
+		/// Identifies the package the image was built from. Images use the same identity as index caches.
+		PakIndexIdentity identity;
+
+		u32 fileCount;
+		u32 entriesOffset;
+	};
+
+	/// Where a file's data is in a package image.
+	struct PakImageEntry {
+		u32 nameHash;
+		u32 size;
+
+		/// Offset of the file's data from the start of the image.
+		u64 offset;
+	};
+
+	/// A mapped package image.
+	class PakImage {
+		Unique<impl::MappedFile> mapping;
+
+		/// Sorted by name hash.
+		std::span<const PakImageEntry> entries;
+
+		PakImage() = default;
+
+	   public:
+		/// Decodes the whole of a file into the given span, which is exactly as large as the file.
+		/// Returns false on failure.
+		using FileDecoder = std::function<bool(const FileMetadata&, std::span<u8>)>;
+
+		/// Maps the package image at [path]. Returns a null pointer if there isn't one, it's malformed,
+		/// or it was built from a package other than the one [identity] describes.
+		static Unique<PakImage> open(const std::filesystem::path& path, const PakIndexIdentity& identity);
+
+		/// Writes an image of [files] to [path], decoding each file with [decodeFile]. Files are decoded
+		/// (and their data laid out) in the order given. The image is written to a temporary file first,
+		/// so that other processes never map a partially written image.
+		static bool write(const std::filesystem::path& path, const PakIndexIdentity& identity, std::span<const FileMetadata* const> files, const FileDecoder& decodeFile);
+
+		/// Returns the data of the file with the name hash [nameHash], or an empty optional if it isn't in the image.
+		/// The data remains valid for as long as the image is mapped.
+		std::optional<std::span<const u8>> findFile(u32 nameHash) const;
+	};
+
+} // namespace jmmt::fs
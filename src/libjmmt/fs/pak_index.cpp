@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <jmmt/crc.hpp>
+#include <libjmmt/impl/replace_file.hpp>
+#include <mco/io/file_stream.hpp>
+#include <optional>
+#include <type_traits>
+
+#include "pak_index.hpp"
+
+namespace jmmt::fs {
+
+	u32 computeHeaderChecksum(std::span<const u8> headerBlock) {
+		auto checksummed = headerBlock.first(std::min(headerBlock.size(), HeaderChecksumSize));
+		return jmmt::hashStringCase({ reinterpret_cast<const char*>(checksummed.data()), checksummed.size() });
+	}
+
+	void PakIndex::setStringTable(std::vector<std::string>&& stringTable) {
+		ownedStrings.clear();
+		ownedStringPool.clear();
+		stringTableIndex.clear();
+
+		ownedStrings.reserve(stringTable.size());
+		stringTableIndex.reserve(stringTable.size());
+
+		std::vector<std::string_view> stringViews(stringTable.begin(), stringTable.end());
+		std::vector<Crc32Result> hashes(stringTable.size());
+		jmmt::hashStrings(stringViews, hashes);
+
+		for(StringIndex i = 0; i < stringTable.size(); ++i) {
+			auto& string = stringTable[i];
+			auto hash = hashes[i];
+
+			// If two strings happen to hash the same, the first one wins. If they're
+			// actually the same string, share the first one's pool storage too.
+			auto [it, inserted] = stringTableIndex.try_emplace(hash, i);
+			if(!inserted) {
+				if(auto& existing = ownedStrings[it->second]; std::string_view(ownedStringPool).substr(existing.offset, existing.length) == string) {
+					ownedStrings.push_back(existing);
+					continue;
+				}
+			}
+
+			ownedStrings.push_back({ .offset = static_cast<u32>(ownedStringPool.size()), .length = static_cast<u32>(string.size()) });
+			ownedStringPool += string;
+		}
+
+		strings = ownedStrings;
+		stringPool = ownedStringPool;
+
+		// Files built on demand before the string table was available need their names resolved now.
+		for(auto& [nameHash, lazyFile] : lazyFiles) {
+			if(auto* pRecord = viewStructure<structs::PackageFileHeader>({ lazyChunkData.get(), lazyChunkDataSize }, lazyFile.recordOffset); pRecord)
+				resolveFileStrings(lazyFile.metadata, *pRecord);
+		}
+	}
+
+	void PakIndex::resolveFileStrings(FileMetadata& file, const structs::PackageFileHeader& pfil) const {
+		file.name = findStringHash(pfil.indexName);
+		file.sourceName = findStringHash(pfil.indexSourceName);
+		file.sourceConvertName = findStringHash(pfil.indexSourceConvertName);
+		file.sourceCompressName = findStringHash(pfil.indexSourceCompressName);
+		file.typeName = findStringHash(pfil.indexType);
+	}
+
+	StringIndex PakIndex::findStringHash(u32 nHash) const {
+		if(auto it = stringTableIndex.find(nHash); it != stringTableIndex.end())
+			return it->second;
+		return InvalidString;
+	}
+
+	std::string_view PakIndex::getString(StringIndex index) const {
+		if(index >= strings.size())
+			return {};
+
+		auto& entry = strings[index];
+		if(entry.offset > stringPool.size() || stringPool.size() - entry.offset < entry.length)
+			return {};
+		return stringPool.substr(entry.offset, entry.length);
+	}
+
+	bool PakIndex::processChunks(std::span<const u8> chunkData) {
+		ownedFiles.clear();
+		ownedChunks.clear();
+
+		// The file the PFIL records currently being read belong to. Chunk 0 of a file
+		// always comes first, so this is set before any other chunk refers to it.
+		FileMetadata* pCurrentFile = nullptr;
+
+		auto onGroup = [&](const structs::PackageGroupHeader& group) {
+			// might be nice to provide this?
+			packageGroup = group;
+			return true;
+		};
+
+		auto onFile = [&](const structs::PackageFileHeader& pfil, usize) {
+			if(pfil.chunkNumber == 0) {
+				if(pfil.chunkCount <= 0)
+					return false;
+
+				// Create metadata for this file, and allocate its chunks.
+				pCurrentFile = &ownedFiles.emplace_back(FileMetadata {
+				.nameHash = pfil.indexName,
+				.firstChunk = static_cast<u32>(ownedChunks.size()),
+				.nChunks = static_cast<u32>(pfil.chunkCount),
+				.fileSize = pfil.totalFileSize,
+				.dateStamp = pfil.dayCreated });
+				resolveFileStrings(*pCurrentFile, pfil);
+				ownedChunks.resize(ownedChunks.size() + pfil.chunkCount);
+			}
+
+			// A chunk without a preceeding chunk 0, or one which is out of range,
+			// means the header data is corrupt.
+			if(!pCurrentFile || pfil.chunkNumber < 0 || pfil.chunkNumber >= pCurrentFile->nChunks)
+				return false;
+
+			// Fill in the chunk in the file metadata.
+			ownedChunks[pCurrentFile->firstChunk + pfil.chunkNumber] = {
+				.chunkByteOffset = pfil.chunkOffset,
+				.chunkDataOffset = pfil.dataOffset,
+				.chunkDataSize = pfil.dataSize,
+				.chunkUncompressedSize = pfil.chunkSize
+			};
+			return true;
+		};
+
+		if(!parsePackageChunks(chunkData, onGroup, onFile))
+			return false;
+
+		// Sort files by their name hash, so they can be looked up with a binary search.
+		// If a package somehow has two files with the same name, the first one wins.
+		std::stable_sort(ownedFiles.begin(), ownedFiles.end(), [](const FileMetadata& lhs, const FileMetadata& rhs) {
+			return lhs.nameHash < rhs.nameHash;
+		});
+
+		files = ownedFiles;
+		chunks = ownedChunks;
+		return true;
+	}
+
+	bool PakIndex::processChunksLazy(Unique<u8[]> chunkData, usize chunkDataSize) {
+		lazyFileOffsets.clear();
+
+		auto onGroup = [&](const structs::PackageGroupHeader& group) {
+			packageGroup = group;
+			return true;
+		};
+
+		auto onFile = [&](const structs::PackageFileHeader& pfil, usize offset) {
+			// If a package somehow has two files with the same name, the first one wins.
+			if(pfil.chunkNumber == 0)
+				lazyFileOffsets.try_emplace(pfil.indexName, static_cast<u32>(offset));
+			return true;
+		};
+
+		if(!parsePackageChunks({ chunkData.get(), chunkDataSize }, onGroup, onFile))
+			return false;
+
+		lazyChunkData = std::move(chunkData);
+		lazyChunkDataSize = chunkDataSize;
+		return true;
+	}
+
+	const FileMetadata* PakIndex::buildLazyFile(u32 nameHash, u32 recordOffset) {
+		std::span<const u8> chunkData { lazyChunkData.get(), lazyChunkDataSize };
+
+		auto* pFirst = viewStructure<structs::PackageFileHeader>(chunkData, recordOffset);
+		if(!pFirst || pFirst->chunkCount <= 0)
+			return nullptr;
+
+		LazyFile file {
+			.metadata = {
+			.nameHash = nameHash,
+			.firstChunk = LazyChunks,
+			.nChunks = static_cast<u32>(pFirst->chunkCount),
+			.fileSize = pFirst->totalFileSize,
+			.dateStamp = pFirst->dayCreated },
+			.recordOffset = recordOffset
+		};
+		resolveFileStrings(file.metadata, *pFirst);
+		file.chunks.resize(file.metadata.nChunks);
+
+		// The rest of the file's PFIL records follow the first one.
+		u32 nChunksFound = 0;
+		auto onGroup = [&](const structs::PackageGroupHeader&) {
+			return true;
+		};
+
+		auto onFile = [&](const structs::PackageFileHeader& pfil, usize) {
+			// Stop (without failing) once we reach the next file.
+			if(pfil.indexName != nameHash || (nChunksFound != 0 && pfil.chunkNumber == 0) || nChunksFound == file.metadata.nChunks)
+				return false;
+
+			if(pfil.chunkNumber < 0 || pfil.chunkNumber >= file.metadata.nChunks)
+				return false;
+
+			file.chunks[pfil.chunkNumber] = {
+				.chunkByteOffset = pfil.chunkOffset,
+				.chunkDataOffset = pfil.dataOffset,
+				.chunkDataSize = pfil.dataSize,
+				.chunkUncompressedSize = pfil.chunkSize
+			};
+			nChunksFound++;
+			return true;
+		};
+
+		parsePackageChunks(chunkData.subspan(recordOffset), onGroup, onFile);
+		if(nChunksFound != file.metadata.nChunks)
+			return nullptr;
+
+		auto [it, inserted] = lazyFiles.emplace(nameHash, std::move(file));
+		lazyFileChunksSize += it->second.chunks.capacity() * sizeof(ChunkMetadata);
+		return &it->second.metadata;
+	}
+
+	bool PakIndex::buildLazyIndex() {
+		if(!isLazy())
+			return true;
+
+		if(!processChunks({ lazyChunkData.get(), lazyChunkDataSize }))
+			return false;
+
+		// Lazily built files are kept, since open files still refer to them.
+		lazyChunkData.reset();
+		lazyChunkDataSize = 0;
+		lazyFileOffsets.clear();
+		return true;
+	}
+
+	const FileMetadata* PakIndex::findFile(std::string_view name) {
+		auto nameHash = jmmt::hashString(name);
+
+		if(isLazy()) {
+			if(auto it = lazyFiles.find(nameHash); it != lazyFiles.end())
+				return &it->second.metadata;
+			if(auto it = lazyFileOffsets.find(nameHash); it != lazyFileOffsets.end())
+				return buildLazyFile(nameHash, it->second);
+			return nullptr;
+		}
+
+		auto it = std::lower_bound(files.begin(), files.end(), nameHash, [](const FileMetadata& file, u32 hash) {
+			return file.nameHash < hash;
+		});
+
+		if(it != files.end() && it->nameHash == nameHash)
+			return &(*it);
+		return nullptr;
+	}
+
+	usize PakIndex::getMemorySize() const {
+		// Map nodes are counted as their contents plus a next pointer and the cached hash.
+		auto mapSize = [](const auto& map) {
+			using Node = typename std::remove_cvref_t<decltype(map)>::value_type;
+			return map.size() * (sizeof(Node) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+		};
+
+		auto size = ownedFiles.capacity() * sizeof(FileMetadata) + ownedChunks.capacity() * sizeof(ChunkMetadata) +
+					ownedStrings.capacity() * sizeof(StringEntry) + ownedStringPool.capacity() + lazyChunkDataSize;
+		size += mapSize(stringTableIndex) + mapSize(lazyFileOffsets) + mapSize(lazyFiles) + lazyFileChunksSize;
+		return size;
+	}
+
+	void PakIndex::getFileNameHashes(std::vector<u32>& hashes) const {
+		if(isLazy()) {
+			hashes.reserve(hashes.size() + lazyFileOffsets.size());
+			for(auto& [nameHash, _] : lazyFileOffsets)
+				hashes.push_back(nameHash);
+			return;
+		}
+
+		hashes.reserve(hashes.size() + files.size());
+		for(auto& file : files)
+			hashes.push_back(file.nameHash);
+	}
+
+	std::span<const ChunkMetadata> PakIndex::getChunks(const FileMetadata& file) const {
+		if(file.firstChunk == LazyChunks) {
+			if(auto it = lazyFiles.find(file.nameHash); it != lazyFiles.end())
+				return it->second.chunks;
+			return {};
+		}
+
+		// An index cache isn't validated up front (to keep adopting one cheap),
+		// so make sure a file can't refer to chunks outside of the index.
+		if(file.firstChunk > chunks.size() || chunks.size() - file.firstChunk < file.nChunks)
+			return {};
+		return chunks.subspan(file.firstChunk, file.nChunks);
+	}
+
+	namespace {
+		/// Returns a view of [count] elements at [offset] in an index cache,
+		/// or an empty optional if they wouldn't fit.
+		template <class T>
+		std::optional<std::span<const T>> viewCacheSection(std::span<const u8> cache, u32 offset, u32 count) {
+			if(offset % alignof(T) != 0 || offset > cache.size())
+				return std::nullopt;
+			if((cache.size() - offset) / sizeof(T) < count)
+				return std::nullopt;
+			return std::span<const T>(reinterpret_cast<const T*>(cache.data() + offset), count);
+		}
+
+		/// Aligns [offset] up to the alignment every index cache section has.
+		constexpr u32 alignCacheSection(u32 offset) {
+			return (offset + 7) & ~7u;
+		}
+	} // namespace
+
+	bool PakIndex::adoptCache(Unique<impl::MappedFile> mapping, const PakIndexIdentity& identity) {
+		auto cache = mapping->getSpan();
+
+		auto* pHeader = viewStructure<PakIndexCacheHeader>(cache, 0);
+		if(!pHeader)
+			return false;
+
+		if(pHeader->magic != PakIndexCacheHeader::MAGIC || pHeader->version != PakIndexCacheHeader::VERSION)
+			return false;
+
+		// Don't use a stale cache.
+		if(pHeader->identity != identity)
+			return false;
+
+		auto cachedFiles = viewCacheSection<FileMetadata>(cache, pHeader->filesOffset, pHeader->fileCount);
+		auto cachedChunks = viewCacheSection<ChunkMetadata>(cache, pHeader->chunksOffset, pHeader->chunkCount);
+		auto cachedStrings = viewCacheSection<StringEntry>(cache, pHeader->stringsOffset, pHeader->stringCount);
+		auto cachedStringPool = viewCacheSection<char>(cache, pHeader->stringPoolOffset, pHeader->stringPoolSize);
+		if(!cachedFiles || !cachedChunks || !cachedStrings || !cachedStringPool)
+			return false;
+
+		packageGroup = pHeader->packageGroup;
+		files = *cachedFiles;
+		chunks = *cachedChunks;
+		strings = *cachedStrings;
+		stringPool = { cachedStringPool->data(), cachedStringPool->size() };
+		cacheMapping = std::move(mapping);
+		return true;
+	}
+
+	bool PakIndex::writeCache(const std::filesystem::path& path, const PakIndexIdentity& identity) const {
+		PakIndexCacheHeader header {
+			.magic = PakIndexCacheHeader::MAGIC,
+			.version = PakIndexCacheHeader::VERSION,
+			.identity = identity,
+			.packageGroup = packageGroup,
+			.fileCount = static_cast<u32>(files.size()),
+			.chunkCount = static_cast<u32>(chunks.size()),
+			.stringCount = static_cast<u32>(strings.size()),
+			.stringPoolSize = static_cast<u32>(stringPool.size())
+		};
+
+		header.filesOffset = alignCacheSection(sizeof(header));
+		header.chunksOffset = alignCacheSection(header.filesOffset + files.size_bytes());
+		header.stringsOffset = alignCacheSection(header.chunksOffset + chunks.size_bytes());
+		header.stringPoolOffset = alignCacheSection(header.stringsOffset + strings.size_bytes());
+
+		return impl::writeFileReplacing(path, [&](mco::FileStream& stream) {
+			auto writeSection = [&](u32 offset, const void* pData, usize size) {
+				static constexpr u8 padding[8] {};
+				auto padSize = offset - stream.tell();
+				if(stream.write(&padding[0], padSize) != padSize)
+					return false;
+				return stream.write(pData, size) == size;
+			};
+
+			return stream.write(&header, sizeof(header)) == sizeof(header) &&
+				   writeSection(header.filesOffset, files.data(), files.size_bytes()) &&
+				   writeSection(header.chunksOffset, chunks.data(), chunks.size_bytes()) &&
+				   writeSection(header.stringsOffset, strings.data(), strings.size_bytes()) &&
+				   writeSection(header.stringPoolOffset, stringPool.data(), stringPool.size());
+		});
+	}
+
+} // namespace jmmt::fs
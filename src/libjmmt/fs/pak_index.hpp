@@ -0,0 +1,298 @@
+//! Package header index. This is an implementation detail of the package filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <jmmt/impl/mapped_file.hpp>
+#include <jmmt/structs/package/file.hpp>
+#include <jmmt/structs/package/group.hpp>
+#include <mco/base_types.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jmmt::fs {
+
+	/// A reference to a string in a package index; the index of the string in the package string table.
+	using StringIndex = u32;
+
+	/// A [StringIndex] which doesn't refer to any string.
+	constexpr static StringIndex InvalidString = 0xffffffff;
+
+	/// [FileMetadata::firstChunk] value of files whose chunks were built on demand by a lazily
+	/// initialized index. Their chunks are kept with the file rather than in the index's chunk array.
+	constexpr static u32 LazyChunks = 0xffffffff;
+
+	/// This data is used to store the chunk information.
+	/// We pre-create this for every chunk of every file inside of a package file
+	/// when initializing the package filesystem.
+	struct ChunkMetadata {
+		u32 chunkByteOffset;	   // The offset where this chunk is placed
+		u32 chunkDataOffset;	   // Offset in .pak file where this chunk starts
+		u32 chunkDataSize;		   // The size of the chunk data inside of the pak
+		u32 chunkUncompressedSize; // The uncompressed size of the chunk.
+
+		/// True if this chunk is compressed. Chunks which are stored as-is are the same size as their data.
+		bool isCompressed() const {
+			return chunkUncompressedSize != chunkDataSize;
+		}
+	};
+
+	/// Metadata for a file inside of a package file.
+	///
+	/// This (like everything else a [PakIndex] stores) is plain data with no pointers,
+	/// so that a package index can be written to an index cache and mapped back in as-is.
+	/// Chunks and strings are referred to by their index in the [PakIndex].
+	struct FileMetadata {
+		u32 nameHash;
+		StringIndex name;
+
+		// TODO: Should these be optional? The only hash that should always exist
+		// (and does) is the file name itself.
+		StringIndex sourceName;
+		StringIndex sourceConvertName;
+		StringIndex sourceCompressName;
+		StringIndex typeName;
+
+		u32 firstChunk;
+		u32 nChunks;
+
+		u32 fileSize;
+		u32 dateStamp;
+	};
+
+	/// Location of a string in the string pool of a package index.
+	struct StringEntry {
+		u32 offset;
+		u32 length;
+	};
+
+	/// Identifies the exact package file an index cache was built from.
+	/// An index cache is only used if this matches the package being opened.
+	struct PakIndexIdentity {
+		u64 pakSize;
+		i64 pakModifiedTime;
+
+		/// Checksum of the start of the package header block; see [computeHeaderChecksum].
+		u32 headerChecksum;
+
+		// The package.toc entry of the package.
+		u32 chunkStartOffset;
+		u32 chunkDataSize;
+		u32 nrPackageFiles;
+
+		bool operator==(const PakIndexIdentity&) const = default;
+	};
+
+	/// The amount of bytes at the start of a package header block covered by [PakIndexIdentity::headerChecksum].
+	/// The pak size and modification time catch most changes to a package; the checksum catches
+	/// packages which were rewritten in place (or copied with their modification time kept) without needing
+	/// to read the whole header block.
+	constexpr static usize HeaderChecksumSize = 4096;
+
+	/// Computes the header checksum of a package from the start of its header block.
+	u32 computeHeaderChecksum(std::span<const u8> headerBlock);
+
+	/// Header of an index cache file. This is followed by the file, chunk, string and
+	/// string pool sections, at the offsets given in the header.
+	struct PakIndexCacheHeader {
+		constexpr static auto MAGIC = FourCCGenerator<>::generate<"JMIX">();
+		constexpr static u32 VERSION = 1;
+
+		FourCC magic;
+		u32 version;
+
+		PakIndexIdentity identity;
+		structs::PackageGroupHeader packageGroup;
+
+		u32 fileCount;
+		u32 chunkCount;
+		u32 stringCount;
+		u32 stringPoolSize;
+
+		u32 filesOffset;
+		u32 chunksOffset;
+		u32 stringsOffset;
+		u32 stringPoolOffset;
+	};
+
+	/// Returns a typed view of a structure at [offset] in [data], or a null pointer if
+	/// the structure would run past the end of the buffer or isn't suitably aligned.
+	/// The structures in package headers are plain data, so they can be viewed in place.
+	template <class T>
+	const T* viewStructure(std::span<const u8> data, usize offset) {
+		if(offset > data.size() || data.size() - offset < sizeof(T))
+			return nullptr;
+
+		auto* pData = data.data() + offset;
+		if(reinterpret_cast<std::uintptr_t>(pData) % alignof(T) != 0)
+			return nullptr;
+
+		return reinterpret_cast<const T*>(pData);
+	}
+
+	// Every header structure is a multiple of the alignment of the others,
+	// so as long as the header buffer itself is aligned, every record in it is too.
+	static_assert(sizeof(structs::PackageGroupHeader) % alignof(structs::PackageFileHeader) == 0);
+	static_assert(sizeof(structs::PackageFileHeader) % alignof(structs::PackageGroupHeader) == 0);
+
+	/// Walks the PGRP/PFIL chunk data of a package in place, calling [onGroup] or [onFile]
+	/// with a view of each record. Callbacks return false to stop parsing with an error.
+	/// Returns false if the chunk data is malformed, or if a callback failed.
+	template <class OnGroup, class OnFile>
+	bool parsePackageChunks(std::span<const u8> chunkData, OnGroup&& onGroup, OnFile&& onFile) {
+		usize offset = 0;
+		while(offset < chunkData.size()) {
+			// Peek the chunk id so we can figure out what chunk it is.
+			auto* pChunkId = viewStructure<FourCC>(chunkData, offset);
+			if(!pChunkId)
+				return false;
+
+			switch(*pChunkId) {
+				case structs::PackageGroupHeader::MAGIC: {
+					auto* pGroup = viewStructure<structs::PackageGroupHeader>(chunkData, offset);
+					if(!pGroup || !onGroup(*pGroup))
+						return false;
+					offset += sizeof(structs::PackageGroupHeader);
+				} break;
+
+				case structs::PackageFileHeader::MAGIC: {
+					auto* pFile = viewStructure<structs::PackageFileHeader>(chunkData, offset);
+					if(!pFile || !onFile(*pFile, offset))
+						return false;
+					offset += sizeof(structs::PackageFileHeader);
+				} break;
+
+				default:
+					// Invalid type, just fail.
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	/// The index of a package's files, built from its header chunk data and string table
+	/// (or adopted from an index cache).
+	class PakIndex {
+		structs::PackageGroupHeader packageGroup {};
+
+		// Views of the index data. These either point into the owned
+		// data below, or into a mapped index cache.
+		std::span<const FileMetadata> files;
+		std::span<const ChunkMetadata> chunks;
+		std::span<const StringEntry> strings;
+		std::string_view stringPool;
+
+		// Index data built by parsing a package.
+		std::vector<FileMetadata> ownedFiles;
+		std::vector<ChunkMetadata> ownedChunks;
+		std::vector<StringEntry> ownedStrings;
+		std::string ownedStringPool;
+
+		/// Maps a string hash to its index in the string table. Built once after the string table is read,
+		/// so that resolving the hashed names in PFIL records doesn't need to scan the table.
+		std::unordered_map<u32, StringIndex> stringTableIndex;
+
+		/// The index cache mapping the views point into, if the index was adopted from one.
+		Unique<impl::MappedFile> cacheMapping;
+
+		/// A file built on demand by a lazily initialized index.
+		struct LazyFile {
+			FileMetadata metadata;
+			std::vector<ChunkMetadata> chunks;
+
+			/// Offset of the file's first PFIL record in the header chunk data.
+			u32 recordOffset;
+		};
+
+		/// The header chunk data of a lazily initialized index. Kept until the index is fully built.
+		Unique<u8[]> lazyChunkData;
+		usize lazyChunkDataSize = 0;
+
+		/// Offset of the first PFIL record of every file, keyed by name hash.
+		std::unordered_map<u32, u32> lazyFileOffsets;
+
+		/// Files which have been built on demand. These are never removed (even once the index
+		/// is fully built), since open files hold references to them.
+		std::unordered_map<u32, LazyFile> lazyFiles;
+
+		/// Bytes held by the chunks of [lazyFiles], so that [getMemorySize] stays cheap as files are built.
+		usize lazyFileChunksSize = 0;
+
+		/// Resolves the string indices of [file] from its PFIL record.
+		void resolveFileStrings(FileMetadata& file, const structs::PackageFileHeader& pfil) const;
+
+		/// Builds the file with the first PFIL record at [recordOffset] in the lazy header chunk data.
+		const FileMetadata* buildLazyFile(u32 nameHash, u32 recordOffset);
+
+	   public:
+		/// Sets the string table used for name resolution, and indexes it.
+		void setStringTable(std::vector<std::string>&& stringTable);
+
+		/// Resolves a string hash to the index of the string it was made from.
+		/// Returns [InvalidString] if the hash isn't in the string table.
+		StringIndex findStringHash(u32 nHash) const;
+
+		/// Returns the string at [index], or an empty string if the index is invalid.
+		std::string_view getString(StringIndex index) const;
+
+		/// Builds file metadata from the package's header chunk data. The string table
+		/// must be set beforehand. Returns false if the chunk data is malformed.
+		bool processChunks(std::span<const u8> chunkData);
+
+		/// Lazily indexes the package's header chunk data, taking ownership of it. Only the offset of each
+		/// file's first PFIL record is recorded; a file's metadata is built the first time it's looked up.
+		/// Returns false if the chunk data is malformed.
+		bool processChunksLazy(Unique<u8[]> chunkData, usize chunkDataSize);
+
+		/// Returns true if this index was lazily initialized, and hasn't been fully built yet.
+		bool isLazy() const {
+			return lazyChunkData != nullptr;
+		}
+
+		/// Fully builds a lazily initialized index. The string table must be set beforehand.
+		/// Does nothing if the index isn't lazy.
+		bool buildLazyIndex();
+
+		/// Finds the metadata for the file named [name], or returns a null pointer.
+		/// Like the game, files are looked up by the hash of their name. A lazy index builds a file's
+		/// metadata the first time it's looked up, which grows [getMemorySize]; since that mutates the index,
+		/// a lazy index mustn't be looked up in from more than one thread at once.
+		const FileMetadata* findFile(std::string_view name);
+
+		/// Returns (roughly) the bytes of memory the index holds, not counting a mapped index cache.
+		usize getMemorySize() const;
+
+		/// Appends the name hash of every file to [hashes]. Unlike [getFiles], this works on a lazy index.
+		void getFileNameHashes(std::vector<u32>& hashes) const;
+
+		/// Returns the chunks of [file].
+		std::span<const ChunkMetadata> getChunks(const FileMetadata& file) const;
+
+		/// Returns the number of files in the package. Unlike [getFiles], this works on a lazy index.
+		usize getFileCount() const {
+			return isLazy() ? lazyFileOffsets.size() : files.size();
+		}
+
+		/// Returns the metadata of all files, sorted by name hash.
+		/// A lazy index needs to be fully built with [buildLazyIndex] first.
+		std::span<const FileMetadata> getFiles() const {
+			return files;
+		}
+
+		const structs::PackageGroupHeader& getPackageGroup() const {
+			return packageGroup;
+		}
+
+		/// Adopts an index cache. Returns false (leaving the index empty) if the cache
+		/// is malformed or was built from a package other than the one [identity] describes.
+		bool adoptCache(Unique<impl::MappedFile> mapping, const PakIndexIdentity& identity);
+
+		/// Writes this index to an index cache at [path]. The cache is written to a temporary file
+		/// first, so that other processes never map a partially written cache.
+		bool writeCache(const std::filesystem::path& path, const PakIndexIdentity& identity) const;
+	};
+
+} // namespace jmmt::fs
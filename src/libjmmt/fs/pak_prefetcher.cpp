@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cstring>
+#include <jmmt/lzss/decompress.hpp>
+#include <jmmt/trace.hpp>
+
+#include "pak_prefetcher.hpp"
+
+namespace jmmt::fs {
+
+	PakPrefetcher::PakPrefetcher(mco::FileStream&& packageFileStream, std::vector<ChunkMetadata> plan, u64 maxBytes, StatsCounters& stats, MemoryBudget& budget)
+		: packageFileStream(std::move(packageFileStream)), stats(stats), budget(budget), maxBytes(maxBytes) {
+		this->plan.reserve(plan.size());
+		for(auto& chunk : plan)
+			if(planIndices.try_emplace(chunk.chunkDataOffset, this->plan.size()).second)
+				this->plan.push_back(chunk);
+
+		thread = std::jthread([this](std::stop_token stopToken) {
+			run(stopToken);
+		});
+	}
+
+	PakPrefetcher::~PakPrefetcher() {
+		thread.request_stop();
+		thread.join();
+	}
+
+	void PakPrefetcher::run(std::stop_token stopToken) {
+		std::vector<u8> chunkData;
+		for(usize i = 0; i < plan.size(); ++i) {
+			auto& chunk = plan[i];
+
+			// The decompressor may write up to a whole chunk buffer.
+			auto bufferSize = std::max<u32>(chunk.chunkUncompressedSize, 65536);
+
+			std::optional<MemoryReservation> reservation;
+			{
+				// Wait for room. If nothing is ready, a chunk larger than the whole budget still has to be let through.
+				// Waiting for memory is only worth it if taking the ready chunks will give some back.
+				// The predicate runs on every wakeup, so it only checks for memory; it's reserved once the wait is over,
+				// so that a chunk counts as at most one budget denial.
+				std::unique_lock lock(mutex);
+				if(!condition.wait(lock, stopToken, [&]() {
+					   if(!readyChunks.empty() && readyBytes + chunk.chunkUncompressedSize > maxBytes)
+						   return false;
+					   return budget.fits(bufferSize) || readyChunks.empty();
+				   }))
+					return;
+
+				if(i >= consumerPosition)
+					reservation = budget.tryReserve(bufferSize, stats);
+
+				// Don't bother with chunks the files have already gone past, or chunks there's no memory for.
+				if(i < consumerPosition || !reservation)
+					continue;
+			}
+
+			JMMT_TRACE_SCOPE("PakPrefetcher chunk");
+			chunkData.resize(chunk.chunkDataSize);
+			packageFileStream.seek(chunk.chunkDataOffset, mco::Stream::Begin);
+			if(packageFileStream.read(chunkData.data(), chunkData.size()) != chunkData.size())
+				return;
+			stats.recordDiskSeek();
+			stats.recordDiskRead(chunk.chunkDataSize);
+
+			auto decodeStart = std::chrono::steady_clock::now();
+			std::vector<u8> data(bufferSize);
+			if(chunk.isCompressed())
+				lzss::decompress(nullptr, chunkData.data(), chunk.chunkDataSize, data.data());
+			else
+				std::memcpy(data.data(), chunkData.data(), chunk.chunkUncompressedSize);
+			data.resize(chunk.chunkUncompressedSize);
+			stats.recordChunkDecode(chunk.isCompressed(), false, std::chrono::steady_clock::now() - decodeStart);
+
+			std::lock_guard lock(mutex);
+			if(i < consumerPosition)
+				continue;
+			readyBytes += data.size();
+			readyChunks.insert_or_assign(chunk.chunkDataOffset, ReadyChunk { .planIndex = i, .data = std::move(data), .reservation = std::move(*reservation) });
+		}
+	}
+
+	void PakPrefetcher::advanceConsumer(usize planIndex) {
+		if(planIndex < consumerPosition)
+			return;
+
+		consumerPosition = planIndex + 1;
+		std::erase_if(readyChunks, [&](const auto& item) {
+			if(item.second.planIndex >= consumerPosition)
+				return false;
+			readyBytes -= item.second.data.size();
+			return true;
+		});
+		condition.notify_all();
+	}
+
+	bool PakPrefetcher::take(const ChunkMetadata& chunk, u8* pOutput) {
+		auto planIndex = planIndices.find(chunk.chunkDataOffset);
+		if(planIndex == planIndices.end())
+			return false;
+
+		std::lock_guard lock(mutex);
+		auto it = readyChunks.find(chunk.chunkDataOffset);
+		if(it == readyChunks.end()) {
+			// The files got ahead of the prefetcher. Skip it past this chunk, since it's about to be decoded anyway.
+			advanceConsumer(planIndex->second);
+			stats.recordPrefetch(false);
+			return false;
+		}
+
+		std::memcpy(pOutput, it->second.data.data(), it->second.data.size());
+		advanceConsumer(planIndex->second);
+		stats.recordPrefetch(true);
+		return true;
+	}
+
+} // namespace jmmt::fs
@@ -0,0 +1,71 @@
+//! Package chunk prefetching. This is an implementation detail of the package filesystem,
+//! and thus isn't exposed in the public include directory.
+#pragma once
+#include <condition_variable>
+#include <mco/base_types.hpp>
+#include <mco/io/file_stream.hpp>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "memory_budget.hpp"
+#include "pak_index.hpp"
+#include "stats_counters.hpp"
+
+namespace jmmt::fs {
+
+	/// Reads and decodes the chunks of a prefetch plan on a background thread, ahead of the files
+	/// reading them. At most [maxBytes] of decoded chunk data is held at once; the thread waits for
+	/// chunks to be taken before decoding more. Decoded chunks are also held within the memory budget; if it's
+	/// spent and no decoded chunks are waiting to be taken, the chunk is skipped and left to the file to decode.
+	class PakPrefetcher {
+		/// A chunk which has been decoded, and is waiting to be taken.
+		struct ReadyChunk {
+			usize planIndex;
+			std::vector<u8> data;
+			MemoryReservation reservation;
+		};
+
+		mco::FileStream packageFileStream;
+		StatsCounters& stats;
+		MemoryBudget& budget;
+
+		/// The chunks to prefetch, in order, and the plan index of every chunk keyed by its data offset.
+		std::vector<ChunkMetadata> plan;
+		std::unordered_map<u32, usize> planIndices;
+
+		u64 maxBytes;
+
+		std::mutex mutex;
+		std::condition_variable_any condition;
+
+		/// Decoded chunks, keyed by data offset.
+		std::unordered_map<u32, ReadyChunk> readyChunks;
+		u64 readyBytes = 0;
+
+		/// The plan index after the last chunk the files have reached. Chunks before it won't be read
+		/// again (as far as the plan knows), so they aren't prefetched, and are dropped if they were.
+		usize consumerPosition = 0;
+
+		std::jthread thread;
+
+		void run(std::stop_token stopToken);
+
+		/// Moves the consumer position past [planIndex], dropping chunks which were skipped. The mutex must be held.
+		void advanceConsumer(usize planIndex);
+
+	   public:
+		/// Starts prefetching [plan] from [packageFileStream]. Chunks which appear more than once in
+		/// the plan are only prefetched the first time.
+		PakPrefetcher(mco::FileStream&& packageFileStream, std::vector<ChunkMetadata> plan, u64 maxBytes, StatsCounters& stats, MemoryBudget& budget);
+		~PakPrefetcher();
+
+		PakPrefetcher(const PakPrefetcher&) = delete;
+
+		/// If [chunk] has been prefetched, copies its decoded data to [pOutput] and returns true.
+		/// Returns false if it hasn't been (yet), in which case the caller needs to decode it itself.
+		bool take(const ChunkMetadata& chunk, u8* pOutput);
+	};
+
+} // namespace jmmt::fs
@@ -0,0 +1,840 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/pak_writer.hpp>
+#include <jmmt/impl/parallel_for.hpp>
+#include <jmmt/lzss/compress.hpp>
+#include <jmmt/structs/package/file.hpp>
+#include <jmmt/structs/package/group.hpp>
+#include <jmmt/structs/package_toc.hpp>
+#include <libjmmt/impl/replace_file.hpp>
+#include <limits>
+#include <mco/io/file_stream.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "pak_index.hpp"
+
+namespace jmmt::fs {
+
+	namespace {
+
+		/// The amount of file data loaded and compressed at once. Files are written in batches of about this much
+		/// data, so that writing a package doesn't need to hold all of it in memory.
+		constexpr u64 BatchSize = 64 * 1024 * 1024;
+
+		u32 getChunkCount(u64 fileSize) {
+			// Empty files still have a (empty) chunk.
+			return static_cast<u32>(std::max<u64>(1, (fileSize + PakWriter::ChunkSize - 1) / PakWriter::ChunkSize));
+		}
+
+		/// A file to be written to a package.
+		struct PakWriterFile {
+			std::string name;
+			u64 size;
+			PakWriter::DataSource source;
+			PakWriter::FileInfo info;
+		};
+
+		/// The hashes of a file's strings.
+		struct PakWriterFileHashes {
+			u32 name;
+			u32 typeName;
+			u32 sourceName;
+			u32 sourceConvertName;
+			u32 sourceCompressName;
+		};
+
+		/// Builds a package string table. Strings are only stored once.
+		class PakStringTableBuilder {
+			std::vector<std::string> strings;
+			std::unordered_map<std::string, u32> indices;
+
+		   public:
+			/// Adds [string] if it isn't already in the table, and returns its hash.
+			u32 add(std::string_view string);
+
+			/// Returns the size of the string table, as written.
+			u32 getSize() const;
+
+			bool write(mco::FileStream& stream) const;
+		};
+
+		/// The header chunks and string table of an existing package.
+		struct ExistingPakPackage {
+			structs::PackageGroupHeader group;
+
+			/// The PFIL records of every file, in the order they're stored in.
+			std::vector<std::vector<structs::PackageFileHeader>> files;
+
+			std::vector<std::string> strings;
+
+			/// Returns the total amount of PFIL records.
+			u64 getRecordCount() const {
+				u64 nRecords = 0;
+				for(auto& records : files)
+					nRecords += records.size();
+				return nRecords;
+			}
+		};
+
+		/// Loads, compresses and writes the chunks of files.
+		class PakChunkWriter {
+			mco::FileStream& stream;
+			u32 nThreads;
+
+		   public:
+			/// Called with the index of the file, the chunk number, and the chunk as written, for every chunk.
+			using OnChunk = std::function<void(usize, u32, const ChunkMetadata&)>;
+
+			PakChunkWriter(mco::FileStream& stream, u32 nThreads);
+
+			/// Writes the chunks of [files] at the current position of the stream, which is [dataOffset]
+			/// in the package. [dataOffset] is advanced past the written data.
+			PakWriter::Error writeFiles(std::span<const PakWriterFile> files, u64& dataOffset, const OnChunk& onChunk);
+		};
+
+	} // namespace
+
+	// PakStringTableBuilder
+
+	u32 PakStringTableBuilder::add(std::string_view string) {
+		if(auto it = indices.find(std::string(string)); it != indices.end())
+			return hashString(strings[it->second]);
+
+		indices.emplace(std::string(string), static_cast<u32>(strings.size()));
+		strings.emplace_back(string);
+		return hashString(string);
+	}
+
+	u32 PakStringTableBuilder::getSize() const {
+		u32 size = sizeof(u32);
+		for(auto& string : strings)
+			size += static_cast<u32>(string.size()) + 1;
+		return size;
+	}
+
+	bool PakStringTableBuilder::write(mco::FileStream& stream) const {
+		auto nStrings = static_cast<u32>(strings.size());
+		if(stream.write(&nStrings, sizeof(nStrings)) != sizeof(nStrings))
+			return false;
+		for(auto& string : strings)
+			if(stream.write(string.c_str(), string.size() + 1) != string.size() + 1)
+				return false;
+		return true;
+	}
+
+	// PakChunkWriter
+
+	PakChunkWriter::PakChunkWriter(mco::FileStream& stream, u32 nThreads)
+		: stream(stream), nThreads(nThreads) {
+	}
+
+	PakWriter::Error PakChunkWriter::writeFiles(std::span<const PakWriterFile> files, u64& dataOffset, const OnChunk& onChunk) {
+		struct LoadedFile {
+			std::vector<u8> data;
+			u32 firstChunk;
+		};
+
+		struct CompressedChunk {
+			u32 file;
+			u32 offset;
+			u32 size;
+			std::vector<u8> compressed;
+		};
+
+		usize batchStart = 0;
+		while(batchStart < files.size()) {
+			// Gather a batch of files. A file larger than the batch size gets a batch to itself.
+			u64 batchBytes = 0;
+			auto batchEnd = batchStart;
+			while(batchEnd < files.size() && (batchEnd == batchStart || batchBytes + files[batchEnd].size <= BatchSize))
+				batchBytes += files[batchEnd++].size;
+
+			auto batch = files.subspan(batchStart, batchEnd - batchStart);
+			std::vector<LoadedFile> loadedFiles(batch.size());
+			std::vector<CompressedChunk> chunks;
+			for(u32 i = 0; i < batch.size(); ++i) {
+				loadedFiles[i].firstChunk = static_cast<u32>(chunks.size());
+				auto nChunks = getChunkCount(batch[i].size);
+				for(u32 chunk = 0; chunk < nChunks; ++chunk) {
+					auto offset = chunk * PakWriter::ChunkSize;
+					chunks.push_back({ .file = i,
+									   .offset = offset,
+									   .size = static_cast<u32>(std::min<u64>(PakWriter::ChunkSize, batch[i].size - offset)),
+									   .compressed = {} });
+				}
+			}
+
+			// Load the files, and then compress their chunks. Every job only touches its own slot,
+			// and the results are written in order afterwards, so the output doesn't depend on scheduling.
+			std::vector<u8> loadFailed(batch.size());
+			impl::parallelFor(batch.size(), nThreads, [&](usize i) {
+				loadedFiles[i].data.resize(batch[i].size);
+				if(batch[i].size != 0 && !batch[i].source(loadedFiles[i].data))
+					loadFailed[i] = true;
+			});
+			if(std::find(loadFailed.begin(), loadFailed.end(), true) != loadFailed.end())
+				return PakWriter::ReadFailure;
+
+			impl::parallelFor(chunks.size(), nThreads, [&](usize i) {
+				auto& chunk = chunks[i];
+				if(chunk.size == 0)
+					return;
+
+				// Only keep the compressed data if it's smaller. A chunk is considered compressed
+				// if its stored size differs from its real size.
+				chunk.compressed.resize(chunk.size - 1);
+				auto compressedSize = lzss::compress(&loadedFiles[chunk.file].data[chunk.offset], static_cast<i32>(chunk.size), chunk.compressed.data(), static_cast<i32>(chunk.compressed.size()));
+				if(compressedSize > 0)
+					chunk.compressed.resize(compressedSize);
+				else
+					chunk.compressed = {};
+			});
+
+			for(usize i = 0; i < chunks.size(); ++i) {
+				auto& chunk = chunks[i];
+				const u8* pData = chunk.compressed.empty() ? loadedFiles[chunk.file].data.data() + chunk.offset : chunk.compressed.data();
+				u32 dataSize = chunk.compressed.empty() ? chunk.size : static_cast<u32>(chunk.compressed.size());
+
+				if(dataOffset + dataSize > std::numeric_limits<u32>::max())
+					return PakWriter::PackageTooLarge;
+				if(dataSize != 0 && stream.write(pData, dataSize) != dataSize)
+					return PakWriter::WriteFailure;
+
+				ChunkMetadata writtenChunk {
+					.chunkByteOffset = chunk.offset,
+					.chunkDataOffset = static_cast<u32>(dataOffset),
+					.chunkDataSize = dataSize,
+					.chunkUncompressedSize = chunk.size
+				};
+				onChunk(batchStart + chunk.file, static_cast<u32>(i - loadedFiles[chunk.file].firstChunk), writtenChunk);
+				dataOffset += dataSize;
+			}
+
+			batchStart = batchEnd;
+		}
+
+		return PakWriter::Success;
+	}
+
+	// Package writing helpers
+
+	static PakWriter::Error validatePakWriterFiles(std::span<const PakWriterFile> files) {
+		// The package filesystem finds files by the hash of their name, so names can't collide.
+		std::unordered_set<u32> nameHashes;
+		for(auto& file : files) {
+			if(getChunkCount(file.size) > static_cast<u32>(std::numeric_limits<i16>::max()) || file.size > std::numeric_limits<u32>::max())
+				return PakWriter::FileTooLarge;
+			if(!nameHashes.insert(hashString(file.name)).second)
+				return PakWriter::DuplicateFile;
+		}
+		return PakWriter::Success;
+	}
+
+	static u32 addPakWriterFileStrings(PakStringTableBuilder& stringTable, const PakWriterFile& file, PakWriterFileHashes& hashes) {
+		auto& sourceName = file.info.sourceName.empty() ? file.name : file.info.sourceName;
+		hashes.name = stringTable.add(file.name);
+		hashes.typeName = stringTable.add(file.info.typeName);
+		hashes.sourceName = stringTable.add(sourceName);
+		hashes.sourceConvertName = stringTable.add(file.info.sourceConvertName.empty() ? sourceName : file.info.sourceConvertName);
+		hashes.sourceCompressName = stringTable.add(file.info.sourceCompressName.empty() ? sourceName : file.info.sourceCompressName);
+		return getChunkCount(file.size);
+	}
+
+	static structs::PackageFileHeader makePackageFileHeader(const PakWriterFile& file, const PakWriterFileHashes& hashes, u32 chunkNumber, const ChunkMetadata& chunk) {
+		structs::PackageFileHeader pfil {};
+		pfil.magic = structs::PackageFileHeader::MAGIC;
+		pfil.dayCreated = file.info.dateStamp;
+		pfil.chunkNumber = static_cast<i16>(chunkNumber);
+		pfil.chunkCount = static_cast<i16>(getChunkCount(file.size));
+		pfil.indexName = hashes.name;
+		pfil.indexSourceName = hashes.sourceName;
+		pfil.indexSourceConvertName = hashes.sourceConvertName;
+		pfil.indexSourceCompressName = hashes.sourceCompressName;
+		pfil.indexType = hashes.typeName;
+		pfil.chunkSize = chunk.chunkUncompressedSize;
+		pfil.chunkOffset = chunk.chunkByteOffset;
+		pfil.dataSize = chunk.chunkDataSize;
+		pfil.dataOffset = chunk.chunkDataOffset;
+		pfil.totalFileSize = static_cast<u32>(file.size);
+		return pfil;
+	}
+
+	static PakWriter::DataSource makeMemoryDataSource(std::vector<u8> data) {
+		auto pData = std::make_shared<std::vector<u8>>(std::move(data));
+		return [pData](std::span<u8> out) {
+			std::memcpy(out.data(), pData->data(), out.size());
+			return true;
+		};
+	}
+
+	static PakWriter::DataSource makeDiskDataSource(const std::filesystem::path& path) {
+		return [path](std::span<u8> out) {
+			try {
+				auto str = path.string();
+				auto stream = mco::FileStream::open(str.c_str());
+				return stream.read(out.data(), out.size()) == out.size();
+			} catch(std::system_error& err) {
+				return false;
+			}
+		};
+	}
+
+	/// Reads the header chunks and string table of the package in [stream] described by [metadata].
+	static bool readExistingPakPackage(mco::FileStream& stream, const PackageMetadata& metadata, ExistingPakPackage& package) {
+		std::vector<u8> chunkData(metadata.chunkDataSize);
+		stream.seek(metadata.chunkStartOffset, mco::Stream::Begin);
+		if(stream.read(chunkData.data(), chunkData.size()) != chunkData.size())
+			return false;
+
+		bool haveGroup = false;
+		auto onGroup = [&](const structs::PackageGroupHeader& group) {
+			package.group = group;
+			haveGroup = true;
+			return true;
+		};
+		auto onFile = [&](const structs::PackageFileHeader& file, usize) {
+			// The chunks of a file are stored one after another, starting with chunk 0.
+			if(package.files.empty() || file.chunkNumber == 0 || package.files.back().front().indexName != file.indexName)
+				package.files.emplace_back();
+			package.files.back().push_back(file);
+			return true;
+		};
+		if(!parsePackageChunks(chunkData, onGroup, onFile) || !haveGroup)
+			return false;
+
+		// The string table directly follows the header chunks.
+		u32 nStrings {};
+		if(stream.read(&nStrings, sizeof(nStrings)) != sizeof(nStrings))
+			return false;
+		package.strings.reserve(nStrings);
+		for(u32 i = 0; i < nStrings; ++i)
+			package.strings.push_back(stream.readString());
+		return true;
+	}
+
+	/// Makes a header chunk buffer holding [group] (with its entry count set to [nEntries]) and the records of [files].
+	/// The buffer has room for [nExtraRecords] more records after them; [offset] is set to where they go.
+	static std::vector<u8> makeExistingPakHeader(const ExistingPakPackage& package, u32 nEntries, u64 nExtraRecords, usize& offset) {
+		std::vector<u8> header(sizeof(structs::PackageGroupHeader) + (package.getRecordCount() + nExtraRecords) * sizeof(structs::PackageFileHeader));
+		auto group = package.group;
+		group.nEntries = nEntries;
+		std::memcpy(&header[0], &group, sizeof(group));
+
+		offset = sizeof(group);
+		for(auto& records : package.files) {
+			std::memcpy(&header[offset], records.data(), records.size() * sizeof(structs::PackageFileHeader));
+			offset += records.size() * sizeof(structs::PackageFileHeader);
+		}
+		return header;
+	}
+
+	/// Lists the files under [directory], named like [PakWriter::addDirectory] names them, sorted by name.
+	static bool listPakWriterDirectory(const std::filesystem::path& directory, std::vector<std::pair<std::string, std::filesystem::path>>& entries) {
+		std::error_code ec;
+		for(auto it = std::filesystem::recursive_directory_iterator(directory, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+			// Entries whose type can't be read (like symlink loops) fail the scan, instead of throwing.
+			// Dangling symlinks aren't files, so they're skipped like before.
+			auto isFile = it->is_regular_file(ec);
+			if(ec == std::errc::no_such_file_or_directory)
+				ec.clear();
+			if(ec)
+				break;
+			if(!isFile)
+				continue;
+
+			auto name = it->path().lexically_relative(directory).generic_string();
+			std::replace(name.begin(), name.end(), '/', '\\');
+			entries.emplace_back(std::move(name), it->path());
+		}
+		if(ec)
+			return false;
+
+		// Directory iteration order isn't specified, so sort to keep the package reproducible.
+		std::sort(entries.begin(), entries.end());
+		return true;
+	}
+
+	// PakWriter
+
+	struct PakWriter::Impl {
+		std::vector<PakWriterFile> files;
+		std::vector<std::string> extraStrings;
+		std::string groupName;
+		u32 nThreads = 0;
+
+		Error writeImpl(const std::filesystem::path& path, PackageMetadata& metadata) {
+			if(auto error = validatePakWriterFiles(files); error != Success)
+				return error;
+
+			// Build the string table, and figure out how large the header chunks will be.
+			PakStringTableBuilder stringTable;
+			std::vector<PakWriterFileHashes> hashes(files.size());
+			u32 nChunks = 0;
+			for(usize i = 0; i < files.size(); ++i)
+				nChunks += addPakWriterFileStrings(stringTable, files[i], hashes[i]);
+			for(auto& string : extraStrings)
+				stringTable.add(string);
+
+			// Lay the package out as: header chunks, string table, file data.
+			u64 headerSize = sizeof(structs::PackageGroupHeader) + static_cast<u64>(nChunks) * sizeof(structs::PackageFileHeader);
+			u64 dataOffset = headerSize + stringTable.getSize();
+			if(dataOffset > std::numeric_limits<u32>::max())
+				return PackageTooLarge;
+
+			std::vector<u8> header(headerSize);
+			structs::PackageGroupHeader group {
+				.magic = structs::PackageGroupHeader::MAGIC,
+				.indexName = hashString(groupName.empty() ? path.filename().string() : groupName),
+				.nEntries = static_cast<u32>(files.size()),
+				.flagsMask = 0
+			};
+			std::memcpy(&header[0], &group, sizeof(group));
+
+			// Any existing package at [path] is only replaced once the new one has been written in full.
+			auto error = Success;
+			auto fail = [&](Error failure) {
+				error = failure;
+				return false;
+			};
+			auto written = impl::writeFileReplacing(path, [&](mco::FileStream& stream) {
+				// Leave room for the header chunks. They're written last, once the size of every chunk is known.
+				if(stream.write(header.data(), header.size()) != header.size() || !stringTable.write(stream))
+					return fail(WriteFailure);
+
+				usize headerOffset = sizeof(group);
+				PakChunkWriter chunkWriter(stream, nThreads);
+				error = chunkWriter.writeFiles(files, dataOffset, [&](usize file, u32 chunkNumber, const ChunkMetadata& chunk) {
+					auto pfil = makePackageFileHeader(files[file], hashes[file], chunkNumber, chunk);
+					std::memcpy(&header[headerOffset], &pfil, sizeof(pfil));
+					headerOffset += sizeof(pfil);
+				});
+				if(error != Success)
+					return false;
+
+				stream.seek(0, mco::Stream::Begin);
+				if(stream.write(header.data(), header.size()) != header.size())
+					return fail(WriteFailure);
+				return true;
+			});
+			if(!written)
+				return error != Success ? error : WriteFailure;
+
+			metadata = {
+				.nrPackageFiles = static_cast<u32>(files.size()),
+				.chunkStartOffset = 0,
+				.chunkDataSize = static_cast<u32>(headerSize)
+			};
+			return Success;
+		}
+	};
+
+	PakWriter::PakWriter()
+		: impl(std::make_unique<Impl>()) {
+	}
+
+	PakWriter::~PakWriter() = default;
+
+	void PakWriter::setGroupName(std::string_view name) {
+		impl->groupName = name;
+	}
+
+	void PakWriter::setThreadCount(u32 nThreads) {
+		impl->nThreads = nThreads;
+	}
+
+	void PakWriter::addFile(std::string_view name, std::vector<u8> data, FileInfo info) {
+		// Keep the full size, so files too large for a package are caught by [write] instead of being truncated.
+		u64 size = data.size();
+		impl->files.push_back({ .name = std::string(name), .size = size, .source = makeMemoryDataSource(std::move(data)), .info = std::move(info) });
+	}
+
+	void PakWriter::addFile(std::string_view name, u32 size, DataSource source, FileInfo info) {
+		impl->files.push_back({ .name = std::string(name), .size = size, .source = std::move(source), .info = std::move(info) });
+	}
+
+	bool PakWriter::addFileFromDisk(std::string_view name, const std::filesystem::path& path, FileInfo info) {
+		std::error_code ec;
+		auto size = std::filesystem::file_size(path, ec);
+		if(ec)
+			return false;
+
+		impl->files.push_back({ .name = std::string(name), .size = size, .source = makeDiskDataSource(path), .info = std::move(info) });
+		return true;
+	}
+
+	bool PakWriter::addDirectory(const std::filesystem::path& directory) {
+		std::vector<std::pair<std::string, std::filesystem::path>> entries;
+		if(!listPakWriterDirectory(directory, entries))
+			return false;
+
+		for(auto& [name, path] : entries)
+			if(!addFileFromDisk(name, path))
+				return false;
+		return true;
+	}
+
+	void PakWriter::addString(std::string_view string) {
+		impl->extraStrings.emplace_back(string);
+	}
+
+	usize PakWriter::getFileCount() const {
+		return impl->files.size();
+	}
+
+	PakWriter::Error PakWriter::write(const std::filesystem::path& path, PackageMetadata& metadata) {
+		return impl->writeImpl(path, metadata);
+	}
+
+	// PakUpdater
+
+	struct PakUpdater::Impl {
+		std::vector<PakWriterFile> files;
+		std::unordered_set<u32> removedFiles;
+		u32 nThreads = 0;
+
+		Error updateImpl(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated) {
+			if(auto error = validatePakWriterFiles(files); error != PakWriter::Success)
+				return error;
+
+			try {
+				auto str = path.string();
+				auto stream = mco::FileStream::open(str.c_str(), mco::FileStream::ReadWrite);
+
+				ExistingPakPackage existing;
+				if(!readExistingPakPackage(stream, current, existing))
+					return PakWriter::ReadFailure;
+
+				// Drop the records of files which are replaced or removed. Their data is left where it is, as dead space.
+				auto droppedFiles = removedFiles;
+				for(auto& file : files)
+					droppedFiles.insert(hashString(file.name));
+				std::erase_if(existing.files, [&](const std::vector<structs::PackageFileHeader>& records) {
+					return droppedFiles.contains(records.front().indexName);
+				});
+
+				// Keep every existing string, since the records which are kept refer to them.
+				PakStringTableBuilder stringTable;
+				for(auto& string : existing.strings)
+					stringTable.add(string);
+
+				std::vector<PakWriterFileHashes> hashes(files.size());
+				u64 nChunks = 0;
+				for(usize i = 0; i < files.size(); ++i)
+					nChunks += addPakWriterFileStrings(stringTable, files[i], hashes[i]);
+
+				auto nEntries = static_cast<u32>(existing.files.size() + files.size());
+				usize headerOffset = 0;
+				auto header = makeExistingPakHeader(existing, nEntries, nChunks, headerOffset);
+
+				// Append the new data, and then the new header chunks and string table, after everything else in the
+				// package. Nothing the current header refers to is touched, so the package stays readable with the
+				// current package.toc entry until it's replaced with [updated].
+				u64 dataOffset = stream.getSize();
+				stream.seek(static_cast<i64>(dataOffset), mco::Stream::Begin);
+
+				PakChunkWriter chunkWriter(stream, nThreads);
+				auto error = chunkWriter.writeFiles(files, dataOffset, [&](usize file, u32 chunkNumber, const ChunkMetadata& chunk) {
+					auto pfil = makePackageFileHeader(files[file], hashes[file], chunkNumber, chunk);
+					std::memcpy(&header[headerOffset], &pfil, sizeof(pfil));
+					headerOffset += sizeof(pfil);
+				});
+				if(error != PakWriter::Success)
+					return error;
+
+				if(dataOffset + header.size() + stringTable.getSize() > std::numeric_limits<u32>::max())
+					return PakWriter::PackageTooLarge;
+				if(stream.write(header.data(), header.size()) != header.size() || !stringTable.write(stream))
+					return PakWriter::WriteFailure;
+
+				updated = {
+					.nrPackageFiles = nEntries,
+					.chunkStartOffset = static_cast<u32>(dataOffset),
+					.chunkDataSize = static_cast<u32>(header.size())
+				};
+				return PakWriter::Success;
+			} catch(std::system_error& err) {
+				return PakWriter::WriteFailure;
+			}
+		}
+	};
+
+	PakUpdater::PakUpdater()
+		: impl(std::make_unique<Impl>()) {
+	}
+
+	PakUpdater::~PakUpdater() = default;
+
+	void PakUpdater::setThreadCount(u32 nThreads) {
+		impl->nThreads = nThreads;
+	}
+
+	void PakUpdater::addFile(std::string_view name, std::vector<u8> data, FileInfo info) {
+		// Keep the full size, so files too large for a package are caught by [update] instead of being truncated.
+		u64 size = data.size();
+		impl->files.push_back({ .name = std::string(name), .size = size, .source = makeMemoryDataSource(std::move(data)), .info = std::move(info) });
+	}
+
+	void PakUpdater::addFile(std::string_view name, u32 size, DataSource source, FileInfo info) {
+		impl->files.push_back({ .name = std::string(name), .size = size, .source = std::move(source), .info = std::move(info) });
+	}
+
+	bool PakUpdater::addFileFromDisk(std::string_view name, const std::filesystem::path& path, FileInfo info) {
+		std::error_code ec;
+		auto size = std::filesystem::file_size(path, ec);
+		if(ec)
+			return false;
+
+		impl->files.push_back({ .name = std::string(name), .size = size, .source = makeDiskDataSource(path), .info = std::move(info) });
+		return true;
+	}
+
+	bool PakUpdater::addDirectory(const std::filesystem::path& directory) {
+		std::vector<std::pair<std::string, std::filesystem::path>> entries;
+		if(!listPakWriterDirectory(directory, entries))
+			return false;
+
+		for(auto& [name, path] : entries)
+			if(!addFileFromDisk(name, path))
+				return false;
+		return true;
+	}
+
+	void PakUpdater::removeFile(std::string_view name) {
+		impl->removedFiles.insert(hashString(name));
+	}
+
+	usize PakUpdater::getFileCount() const {
+		return impl->files.size();
+	}
+
+	PakUpdater::Error PakUpdater::update(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated) {
+		return impl->updateImpl(path, current, updated);
+	}
+
+	// Package rewriting
+
+	/// Returns the indices of the files of [package], in the order their data is stored in.
+	static std::vector<usize> getExistingPakDataOrder(const ExistingPakPackage& package) {
+		std::vector<usize> order(package.files.size());
+		for(usize i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](usize lhs, usize rhs) {
+			return package.files[lhs].front().dataOffset < package.files[rhs].front().dataOffset;
+		});
+		return order;
+	}
+
+	/// Rewrites the package at [path] without any dead space, laying the data of its files out in the order
+	/// [getDataOrder] returns (as indices into the package's files). The header chunks and string table are kept
+	/// as they are, other than data offsets. Chunk data is copied as stored, without being recompressed.
+	template <class GetDataOrder>
+	static PakWriter::Error rewritePackage(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated, GetDataOrder&& getDataOrder) {
+		u32 nEntries = 0;
+		u64 headerSize = 0;
+
+		// The rewritten package replaces the current one once it's been written in full. The current package
+		// is only open inside the writer, so that it's closed again before it's replaced.
+		auto error = PakWriter::Success;
+		auto fail = [&](PakWriter::Error failure) {
+			error = failure;
+			return false;
+		};
+		auto written = impl::writeFileReplacing(path, [&](mco::FileStream& stream) {
+			auto sourceStr = path.string();
+			auto source = mco::FileStream::open(sourceStr.c_str());
+
+			ExistingPakPackage existing;
+			if(!readExistingPakPackage(source, current, existing))
+				return fail(PakWriter::ReadFailure);
+
+			PakStringTableBuilder stringTable;
+			for(auto& string : existing.strings)
+				stringTable.add(string);
+
+			// Lay the package out like [PakWriter] does: header chunks, string table, file data.
+			nEntries = static_cast<u32>(existing.files.size());
+			headerSize = sizeof(structs::PackageGroupHeader) + existing.getRecordCount() * sizeof(structs::PackageFileHeader);
+			u64 dataOffset = headerSize + stringTable.getSize();
+			if(dataOffset > std::numeric_limits<u32>::max())
+				return fail(PakWriter::PackageTooLarge);
+
+			// Leave room for the header chunks. They're written last, once every chunk's new offset is known.
+			std::vector<u8> placeholder(headerSize);
+			if(stream.write(placeholder.data(), placeholder.size()) != placeholder.size() || !stringTable.write(stream))
+				return fail(PakWriter::WriteFailure);
+
+			std::vector<u8> buffer;
+			for(auto file : getDataOrder(std::as_const(existing))) {
+				for(auto& record : existing.files[file]) {
+					buffer.resize(record.dataSize);
+					source.seek(record.dataOffset, mco::Stream::Begin);
+					if(source.read(buffer.data(), buffer.size()) != buffer.size())
+						return fail(PakWriter::ReadFailure);
+
+					if(dataOffset + buffer.size() > std::numeric_limits<u32>::max())
+						return fail(PakWriter::PackageTooLarge);
+					if(stream.write(buffer.data(), buffer.size()) != buffer.size())
+						return fail(PakWriter::WriteFailure);
+
+					record.dataOffset = static_cast<u32>(dataOffset);
+					dataOffset += buffer.size();
+				}
+			}
+
+			usize headerOffset = 0;
+			auto header = makeExistingPakHeader(existing, nEntries, 0, headerOffset);
+			stream.seek(0, mco::Stream::Begin);
+			if(stream.write(header.data(), header.size()) != header.size())
+				return fail(PakWriter::WriteFailure);
+			return true;
+		});
+		if(!written)
+			return error != PakWriter::Success ? error : PakWriter::WriteFailure;
+
+		updated = {
+			.nrPackageFiles = nEntries,
+			.chunkStartOffset = 0,
+			.chunkDataSize = static_cast<u32>(headerSize)
+		};
+		return PakWriter::Success;
+	}
+
+	PakWriter::Error compactPackage(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated) {
+		// Keep the data in the order it's already in, so that compacting doesn't undo [reorderPackage].
+		return rewritePackage(path, current, updated, getExistingPakDataOrder);
+	}
+
+	PakWriter::Error reorderPackage(const std::filesystem::path& path, const PackageMetadata& current, PackageMetadata& updated, std::span<const u32> fileOrder) {
+		return rewritePackage(path, current, updated, [&](const ExistingPakPackage& package) {
+			std::unordered_map<u32, usize> fileIndices;
+			for(usize i = 0; i < package.files.size(); ++i)
+				fileIndices.emplace(package.files[i].front().indexName, i);
+
+			// Files in [fileOrder] go first. Everything else follows, in the order it was already in.
+			std::vector<usize> order;
+			std::vector<u8> placed(package.files.size());
+			for(auto nameHash : fileOrder) {
+				if(auto it = fileIndices.find(nameHash); it != fileIndices.end() && !placed[it->second]) {
+					order.push_back(it->second);
+					placed[it->second] = true;
+				}
+			}
+			for(auto file : getExistingPakDataOrder(package))
+				if(!placed[file])
+					order.push_back(file);
+			return order;
+		});
+	}
+
+	std::vector<u32> getTraceFileOrder(const AccessTrace& trace) {
+		std::vector<u32> order;
+		std::unordered_set<u32> seen;
+		for(auto& entry : trace.entries)
+			if(auto nameHash = hashString(entry.fileName); seen.insert(nameHash).second)
+				order.push_back(nameHash);
+		return order;
+	}
+
+	bool getPackageGroupFileOrder(const std::filesystem::path& path, const PackageMetadata& metadata, std::vector<u32>& fileOrder) {
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+
+			ExistingPakPackage existing;
+			if(!readExistingPakPackage(stream, metadata, existing))
+				return false;
+
+			fileOrder.clear();
+			for(auto& records : existing.files)
+				fileOrder.push_back(records.front().indexName);
+			return true;
+		} catch(std::system_error& err) {
+			return false;
+		}
+	}
+
+	bool computeSeekReport(const std::filesystem::path& path, const PackageMetadata& metadata, const AccessTrace& trace, SeekReport& report) {
+		ExistingPakPackage existing;
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+			if(!readExistingPakPackage(stream, metadata, existing))
+				return false;
+		} catch(std::system_error& err) {
+			return false;
+		}
+
+		std::unordered_map<u32, const std::vector<structs::PackageFileHeader>*> files;
+		for(auto& records : existing.files)
+			files.emplace(records.front().indexName, &records);
+
+		// Replay the trace against the chunk layout. Like an open file, a chunk is only read once
+		// while reads stay inside it; moving to a chunk which doesn't start where the last one ended is a seek.
+		report = {};
+		const structs::PackageFileHeader* pLastChunk = nullptr;
+		for(auto& entry : trace.entries) {
+			auto it = files.find(hashString(entry.fileName));
+			if(it == files.end())
+				continue;
+
+			for(auto& chunk : *it->second) {
+				if(chunk.chunkOffset >= entry.offset + entry.length || entry.offset >= chunk.chunkOffset + chunk.chunkSize || &chunk == pLastChunk)
+					continue;
+
+				if(pLastChunk && chunk.dataOffset != pLastChunk->dataOffset + pLastChunk->dataSize) {
+					++report.seeks;
+					auto lastEnd = static_cast<i64>(pLastChunk->dataOffset) + pLastChunk->dataSize;
+					report.seekDistance += static_cast<u64>(std::abs(static_cast<i64>(chunk.dataOffset) - lastEnd));
+				}
+				++report.chunkReads;
+				report.bytesRead += chunk.dataSize;
+				pLastChunk = &chunk;
+			}
+		}
+		return true;
+	}
+
+	bool updatePackageToc(const std::filesystem::path& tocPath, std::string_view packageName, const PackageMetadata& metadata) {
+		structs::PackageTocHeader newEntry {};
+		if(packageName.size() >= sizeof(newEntry.fileName))
+			return false;
+		std::memcpy(&newEntry.fileName[0], packageName.data(), packageName.size());
+		newEntry.filenameHash = hashString(packageName);
+		newEntry.tocStartOffset = metadata.chunkStartOffset;
+		newEntry.tocSize = metadata.chunkDataSize;
+		newEntry.tocFileCount = metadata.nrPackageFiles;
+
+		try {
+			// Read the existing entries, if there are any.
+			std::vector<structs::PackageTocHeader> toc;
+			if(std::filesystem::exists(tocPath)) {
+				auto str = tocPath.string();
+				auto stream = mco::FileStream::open(str.c_str());
+				toc.resize(stream.getSize() / sizeof(structs::PackageTocHeader));
+				auto tocSize = toc.size() * sizeof(structs::PackageTocHeader);
+				if(stream.read(toc.data(), tocSize) != tocSize)
+					return false;
+			}
+
+			auto it = std::find_if(toc.begin(), toc.end(), [&](const structs::PackageTocHeader& entry) {
+				return std::string_view(entry.fileName, strnlen(entry.fileName, sizeof(entry.fileName))) == packageName;
+			});
+			if(it != toc.end())
+				*it = newEntry;
+			else
+				toc.push_back(newEntry);
+
+			return impl::writeFileReplacing(tocPath, [&](mco::FileStream& stream) {
+				auto tocSize = toc.size() * sizeof(structs::PackageTocHeader);
+				return stream.write(toc.data(), tocSize) == tocSize;
+			});
+		} catch(std::system_error& err) {
+			return false;
+		}
+	}
+
+} // namespace jmmt::fs
@@ -0,0 +1,58 @@
+#include <jmmt/fs/stats.hpp>
+
+#include "stats_counters.hpp"
+
+namespace jmmt::fs {
+
+	std::chrono::nanoseconds Stats::getFileReadLatencyPercentile(double percentile) const {
+		if(fileReads == 0)
+			return {};
+
+		// Find the bucket holding the read at the requested rank.
+		auto rank = static_cast<u64>((percentile / 100.0) * static_cast<double>(fileReads));
+		u64 cumulative = 0;
+		for(usize i = 0; i < LatencyBucketCount; ++i) {
+			cumulative += fileReadLatency[i];
+			if(cumulative > rank)
+				return std::chrono::nanoseconds(u64(1) << i);
+		}
+
+		return std::chrono::nanoseconds(u64(1) << (LatencyBucketCount - 1));
+	}
+
+	Stats StatsCounters::snapshot() const {
+		auto load = [](const std::atomic<u64>& counter) {
+			return counter.load(std::memory_order_relaxed);
+		};
+
+		Stats stats {
+			.bytesRead = load(bytesRead),
+			.diskReads = load(diskReads),
+			.diskSeeks = load(diskSeeks),
+			.fileOpens = load(fileOpens),
+			.compressedChunksDecoded = load(compressedChunksDecoded),
+			.uncompressedChunksDecoded = load(uncompressedChunksDecoded),
+			.chunkRedecodes = load(chunkRedecodes),
+			.readBufferHits = load(readBufferHits),
+			.readBufferMisses = load(readBufferMisses),
+			.indexCacheHits = load(indexCacheHits),
+			.indexCacheMisses = load(indexCacheMisses),
+			.imageCacheHits = load(imageCacheHits),
+			.imageCacheMisses = load(imageCacheMisses),
+			.prefetchHits = load(prefetchHits),
+			.prefetchMisses = load(prefetchMisses),
+			.memoryInUse = load(memoryInUse),
+			.peakMemoryInUse = load(peakMemoryInUse),
+			.memoryBudgetDenials = load(memoryBudgetDenials),
+			.decodeTime = std::chrono::nanoseconds(load(decodeTime)),
+			.fileReads = load(fileReads),
+			.fileReadLatency = {}
+		};
+
+		for(usize i = 0; i < Stats::LatencyBucketCount; ++i)
+			stats.fileReadLatency[i] = load(fileReadLatency[i]);
+
+		return stats;
+	}
+
+} // namespace jmmt::fs
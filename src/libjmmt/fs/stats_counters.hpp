@@ -0,0 +1,128 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <jmmt/fs/stats.hpp>
+
+namespace jmmt::fs {
+
+	/// Live counters backing [Stats]. Counters are relaxed atomics, so recording is cheap
+	/// and safe from any thread. Everything recorded is also recorded to the parent counters,
+	/// if there are any; this is how the game filesystem totals up its packages' statistics.
+	class StatsCounters {
+		StatsCounters* pParent = nullptr;
+
+		std::atomic<u64> bytesRead {};
+		std::atomic<u64> diskReads {};
+		std::atomic<u64> diskSeeks {};
+		std::atomic<u64> fileOpens {};
+		std::atomic<u64> compressedChunksDecoded {};
+		std::atomic<u64> uncompressedChunksDecoded {};
+		std::atomic<u64> chunkRedecodes {};
+		std::atomic<u64> readBufferHits {};
+		std::atomic<u64> readBufferMisses {};
+		std::atomic<u64> indexCacheHits {};
+		std::atomic<u64> indexCacheMisses {};
+		std::atomic<u64> imageCacheHits {};
+		std::atomic<u64> imageCacheMisses {};
+		std::atomic<u64> prefetchHits {};
+		std::atomic<u64> prefetchMisses {};
+		std::atomic<u64> memoryInUse {};
+		std::atomic<u64> peakMemoryInUse {};
+		std::atomic<u64> memoryBudgetDenials {};
+		std::atomic<u64> decodeTime {};
+		std::atomic<u64> fileReads {};
+		std::array<std::atomic<u64>, Stats::LatencyBucketCount> fileReadLatency {};
+
+		static void add(std::atomic<u64>& counter, u64 value) {
+			counter.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		/// Records to this object's counter, and the same counter of every parent.
+		template <class F>
+		void record(F&& f) {
+			for(auto* pCounters = this; pCounters != nullptr; pCounters = pCounters->pParent)
+				f(*pCounters);
+		}
+
+	   public:
+		StatsCounters() = default;
+
+		explicit StatsCounters(StatsCounters* pParent)
+			: pParent(pParent) {
+		}
+
+		StatsCounters(const StatsCounters&) = delete;
+
+		void recordDiskRead(u64 size) {
+			record([&](StatsCounters& c) {
+				add(c.diskReads, 1);
+				add(c.bytesRead, size);
+			});
+		}
+
+		void recordDiskSeek() {
+			record([](StatsCounters& c) { add(c.diskSeeks, 1); });
+		}
+
+		void recordFileOpen() {
+			record([](StatsCounters& c) { add(c.fileOpens, 1); });
+		}
+
+		void recordChunkDecode(bool compressed, bool redecode, std::chrono::nanoseconds time) {
+			record([&](StatsCounters& c) {
+				add(compressed ? c.compressedChunksDecoded : c.uncompressedChunksDecoded, 1);
+				if(redecode)
+					add(c.chunkRedecodes, 1);
+				add(c.decodeTime, static_cast<u64>(time.count()));
+			});
+		}
+
+		void recordReadBuffer(bool hit) {
+			record([&](StatsCounters& c) { add(hit ? c.readBufferHits : c.readBufferMisses, 1); });
+		}
+
+		void recordIndexCache(bool hit) {
+			record([&](StatsCounters& c) { add(hit ? c.indexCacheHits : c.indexCacheMisses, 1); });
+		}
+
+		void recordImageCache(bool hit) {
+			record([&](StatsCounters& c) { add(hit ? c.imageCacheHits : c.imageCacheMisses, 1); });
+		}
+
+		void recordPrefetch(bool hit) {
+			record([&](StatsCounters& c) { add(hit ? c.prefetchHits : c.prefetchMisses, 1); });
+		}
+
+		/// Records [size] bytes of memory being allocated, updating the peak.
+		void recordMemoryAllocated(u64 size) {
+			record([&](StatsCounters& c) {
+				auto inUse = c.memoryInUse.fetch_add(size, std::memory_order_relaxed) + size;
+				auto peak = c.peakMemoryInUse.load(std::memory_order_relaxed);
+				while(peak < inUse && !c.peakMemoryInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed))
+					;
+			});
+		}
+
+		void recordMemoryFreed(u64 size) {
+			record([&](StatsCounters& c) { c.memoryInUse.fetch_sub(size, std::memory_order_relaxed); });
+		}
+
+		void recordMemoryBudgetDenial() {
+			record([](StatsCounters& c) { add(c.memoryBudgetDenials, 1); });
+		}
+
+		void recordFileRead(std::chrono::nanoseconds time) {
+			auto bucket = std::min<usize>(std::bit_width(static_cast<u64>(time.count())), Stats::LatencyBucketCount - 1);
+			record([&](StatsCounters& c) {
+				add(c.fileReads, 1);
+				add(c.fileReadLatency[bucket], 1);
+			});
+		}
+
+		/// Takes a snapshot of the counters. Counters are read individually,
+		/// so a snapshot taken while other threads are recording may be slightly inconsistent.
+		Stats snapshot() const;
+	};
+
+} // namespace jmmt::fs
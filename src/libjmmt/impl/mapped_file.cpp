@@ -0,0 +1,75 @@
+#include <jmmt/impl/mapped_file.hpp>
+#include <mco/io/file_stream.hpp>
+
+#if __has_include(<sys/mman.h>)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#define JMMT_HAVE_MMAP
+#endif
+
+namespace jmmt::impl {
+
+	Unique<MappedFile> MappedFile::open(const std::filesystem::path& path) {
+		auto mapping = Unique<MappedFile>(new MappedFile());
+
+#ifdef JMMT_HAVE_MMAP
+		auto fd = ::open(path.c_str(), O_RDONLY);
+		if(fd == -1)
+			return nullptr;
+
+		struct stat st {};
+		if(fstat(fd, &st) == -1) {
+			close(fd);
+			return nullptr;
+		}
+
+		mapping->size = static_cast<usize>(st.st_size);
+
+		// mmap() doesn't accept zero-length mappings, but an empty file is still valid.
+		if(mapping->size != 0) {
+			auto* p = mmap(nullptr, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(p == MAP_FAILED) {
+				close(fd);
+				return nullptr;
+			}
+			mapping->pData = static_cast<const u8*>(p);
+		}
+
+		// The mapping stays valid after the descriptor is closed.
+		close(fd);
+#else
+		try {
+			auto str = path.string();
+			auto stream = mco::FileStream::open(str.c_str());
+			mapping->size = stream.getSize();
+			mapping->heapAllocated = true;
+
+			auto* pBuffer = new u8[mapping->size];
+			mapping->pData = pBuffer;
+			if(stream.read(pBuffer, mapping->size) != mapping->size)
+				return nullptr;
+		} catch(std::system_error& err) {
+			return nullptr;
+		}
+#endif
+
+		return mapping;
+	}
+
+	MappedFile::~MappedFile() {
+		if(!pData)
+			return;
+
+		if(heapAllocated) {
+			delete[] pData;
+			return;
+		}
+
+#ifdef JMMT_HAVE_MMAP
+		munmap(const_cast<u8*>(pData), size);
+#endif
+	}
+
+} // namespace jmmt::impl
@@ -0,0 +1,42 @@
+#include <chrono>
+#include <format>
+#include <libjmmt/impl/replace_file.hpp>
+#include <thread>
+
+namespace jmmt::impl {
+
+	bool writeFileReplacing(const std::filesystem::path& path, const std::function<bool(mco::FileStream&)>& write) {
+		auto temporaryPath = path;
+		temporaryPath += std::format(".{:X}.{:X}.tmp", std::hash<std::thread::id> {}(std::this_thread::get_id()), std::chrono::steady_clock::now().time_since_epoch().count());
+
+		std::error_code ec;
+		try {
+			// Close the stream before removing the file, or moving it into place.
+			bool written = false;
+			{
+				auto str = temporaryPath.string();
+				auto stream = mco::FileStream::open(str.c_str(), mco::FileStream::ReadWrite | mco::FileStream::Create);
+				written = write(stream);
+			}
+
+			if(!written) {
+				std::filesystem::remove(temporaryPath, ec);
+				return false;
+			}
+		} catch(std::system_error& err) {
+			std::filesystem::remove(temporaryPath, ec);
+			return false;
+		} catch(...) {
+			std::filesystem::remove(temporaryPath, ec);
+			throw;
+		}
+
+		std::filesystem::rename(temporaryPath, path, ec);
+		if(ec) {
+			std::filesystem::remove(temporaryPath, ec);
+			return false;
+		}
+		return true;
+	}
+
+} // namespace jmmt::impl
@@ -0,0 +1,15 @@
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <mco/io/file_stream.hpp>
+
+namespace jmmt::impl {
+
+	/// Writes the file at [path] by calling [write] with a stream on a temporary file unique to this writer,
+	/// and then moving the temporary file into place. Nothing (not even another process) ever sees a partially
+	/// written file, and concurrent writers don't clobber each other's temporary files. [write] returns false
+	/// (or throws a std::system_error) on failure; the temporary file is removed on every failure path.
+	/// Returns true if the file was written and moved into place.
+	bool writeFileReplacing(const std::filesystem::path& path, const std::function<bool(mco::FileStream&)>& write);
+
+} // namespace jmmt::impl
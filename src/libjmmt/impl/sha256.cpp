@@ -0,0 +1,15 @@
+#include <jmmt/impl/mapped_file.hpp>
+#include <jmmt/impl/sha256.hpp>
+
+// The parts of SHA-256 support which don't depend on the backend (see sha256_builtin.cpp and sha256_openssl.cpp).
+
+namespace jmmt::impl {
+
+	std::optional<ShaDigest> sha256Digest(const std::filesystem::path& path) {
+		auto file = MappedFile::open(path);
+		if(!file)
+			return std::nullopt;
+		return sha256Digest(file->data(), file->getSize());
+	}
+
+} // namespace jmmt::impl
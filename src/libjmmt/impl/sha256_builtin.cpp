@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <jmmt/impl/sha256.hpp>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+	#define JMMT_SHA256_X86
+	#include <immintrin.h>
+
+	#define JMMT_SHA256_SHANI_TARGET __attribute__((target("sha,sse4.1")))
+	#define JMMT_SHA256_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+// Self-contained SHA-256 (FIPS 180-4). Single buffers are hashed with the SHA extensions where the CPU
+// has them, and with portable code otherwise. Many buffers at once are hashed eight at a time with AVX2
+// on CPUs which have it but lack the SHA extensions; with the SHA extensions, one buffer at a time is
+// already faster than that.
+
+namespace jmmt::impl {
+
+	namespace {
+
+		constexpr u32 RoundConstants[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		constexpr u32 InitialState[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+
+		constexpr usize BlockSize = 64;
+
+		inline u32 loadBigEndian32(const u8* pData) {
+			return (u32(pData[0]) << 24) | (u32(pData[1]) << 16) | (u32(pData[2]) << 8) | u32(pData[3]);
+		}
+
+		/// Writes the final [state] out as a digest.
+		ShaDigest makeDigest(const u32* pState) {
+			ShaDigest digest;
+			for(usize i = 0; i < 8; ++i) {
+				digest[i * 4 + 0] = static_cast<u8>(pState[i] >> 24);
+				digest[i * 4 + 1] = static_cast<u8>(pState[i] >> 16);
+				digest[i * 4 + 2] = static_cast<u8>(pState[i] >> 8);
+				digest[i * 4 + 3] = static_cast<u8>(pState[i]);
+			}
+			return digest;
+		}
+
+		/// Builds the padded final block(s) of a message of [size] bytes, whose last [size % BlockSize] bytes are
+		/// [pTail]. Returns the amount of blocks written to [pBlocks] (1 or 2).
+		usize makeFinalBlocks(u8* pBlocks, const u8* pTail, u64 size) {
+			auto tailSize = static_cast<usize>(size % BlockSize);
+			auto nBlocks = tailSize + 9 <= BlockSize ? 1 : 2;
+
+			std::memset(pBlocks, 0, nBlocks * BlockSize);
+			std::memcpy(pBlocks, pTail, tailSize);
+			pBlocks[tailSize] = 0x80;
+
+			auto bitSize = size * 8;
+			for(usize i = 0; i < 8; ++i)
+				pBlocks[nBlocks * BlockSize - 1 - i] = static_cast<u8>(bitSize >> (i * 8));
+			return nBlocks;
+		}
+
+		void compressScalar(u32* pState, const u8* pData, usize nBlocks) {
+			for(; nBlocks != 0; --nBlocks, pData += BlockSize) {
+				u32 w[64];
+				for(usize t = 0; t < 16; ++t)
+					w[t] = loadBigEndian32(pData + t * 4);
+				for(usize t = 16; t < 64; ++t) {
+					auto s0 = std::rotr(w[t - 15], 7) ^ std::rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+					auto s1 = std::rotr(w[t - 2], 17) ^ std::rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+					w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+				}
+
+				auto a = pState[0], b = pState[1], c = pState[2], d = pState[3];
+				auto e = pState[4], f = pState[5], g = pState[6], h = pState[7];
+				for(usize t = 0; t < 64; ++t) {
+					auto t1 = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) + RoundConstants[t] + w[t];
+					auto t2 = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+					h = g;
+					g = f;
+					f = e;
+					e = d + t1;
+					d = c;
+					c = b;
+					b = a;
+					a = t1 + t2;
+				}
+
+				pState[0] += a;
+				pState[1] += b;
+				pState[2] += c;
+				pState[3] += d;
+				pState[4] += e;
+				pState[5] += f;
+				pState[6] += g;
+				pState[7] += h;
+			}
+		}
+
+#ifdef JMMT_SHA256_X86
+		JMMT_SHA256_SHANI_TARGET void compressShaNi(u32* pState, const u8* pData, usize nBlocks) {
+			const auto byteSwapMask = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+			// The SHA instructions want the state as ABEF and CDGH.
+			auto cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&pState[0])), 0xb1);
+			auto efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&pState[4])), 0x1b);
+			auto abef = _mm_alignr_epi8(cdab, efgh, 8);
+			auto cdgh = _mm_blend_epi16(efgh, cdab, 0xf0);
+
+			for(; nBlocks != 0; --nBlocks, pData += BlockSize) {
+				auto savedAbef = abef;
+				auto savedCdgh = cdgh;
+
+				// Each group of four rounds uses four message words; from the fifth group on, they're
+				// computed from the four groups before.
+				__m128i w[4];
+#pragma GCC unroll 16
+				for(usize i = 0; i < 16; ++i) {
+					if(i < 4) {
+						w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + i * 16)), byteSwapMask);
+					} else {
+						auto sum = _mm_add_epi32(_mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]), _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4));
+						w[i % 4] = _mm_sha256msg2_epu32(sum, w[(i + 3) % 4]);
+					}
+
+					auto message = _mm_add_epi32(w[i % 4], _mm_loadu_si128(reinterpret_cast<const __m128i*>(&RoundConstants[i * 4])));
+					cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+					abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(message, 0x0e));
+				}
+
+				abef = _mm_add_epi32(abef, savedAbef);
+				cdgh = _mm_add_epi32(cdgh, savedCdgh);
+			}
+
+			auto feba = _mm_shuffle_epi32(abef, 0x1b);
+			auto dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pState[0]), _mm_blend_epi16(feba, dchg, 0xf0));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&pState[4]), _mm_alignr_epi8(dchg, feba, 8));
+		}
+
+		JMMT_SHA256_AVX2_TARGET inline __m256i rotr8x32(__m256i x, int n) {
+			return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+		}
+
+		/// Compresses one block for each of eight messages at once. [state] holds the state of every message,
+		/// word by word ([state][word][message]), so each word of all eight states is a single vector.
+		JMMT_SHA256_AVX2_TARGET void compressAvx2x8(u32 (&state)[8][8], const u8* const (&ppBlocks)[8]) {
+			__m256i w[16];
+			for(usize t = 0; t < 16; ++t) {
+				w[t] = _mm256_setr_epi32(loadBigEndian32(ppBlocks[0] + t * 4), loadBigEndian32(ppBlocks[1] + t * 4),
+										 loadBigEndian32(ppBlocks[2] + t * 4), loadBigEndian32(ppBlocks[3] + t * 4),
+										 loadBigEndian32(ppBlocks[4] + t * 4), loadBigEndian32(ppBlocks[5] + t * 4),
+										 loadBigEndian32(ppBlocks[6] + t * 4), loadBigEndian32(ppBlocks[7] + t * 4));
+			}
+
+			__m256i v[8];
+			for(usize i = 0; i < 8; ++i)
+				v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[i]));
+			auto [a, b, c, d, e, f, g, h] = v;
+
+			for(usize t = 0; t < 64; ++t) {
+				// The message schedule is kept as a rolling window of the last 16 words.
+				if(t >= 16) {
+					auto w15 = w[(t - 15) % 16];
+					auto w2 = w[(t - 2) % 16];
+					auto s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(w15, 7), rotr8x32(w15, 18)), _mm256_srli_epi32(w15, 3));
+					auto s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(w2, 17), rotr8x32(w2, 19)), _mm256_srli_epi32(w2, 10));
+					w[t % 16] = _mm256_add_epi32(_mm256_add_epi32(w[t % 16], s0), _mm256_add_epi32(w[(t - 7) % 16], s1));
+				}
+
+				auto sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(e, 6), rotr8x32(e, 11)), rotr8x32(e, 25));
+				auto choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+				auto t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1), _mm256_add_epi32(choose, _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(RoundConstants[t])), w[t % 16])));
+				auto sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr8x32(a, 2), rotr8x32(a, 13)), rotr8x32(a, 22));
+				auto majority = _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+				auto t2 = _mm256_add_epi32(sigma0, majority);
+
+				h = g;
+				g = f;
+				f = e;
+				e = _mm256_add_epi32(d, t1);
+				d = c;
+				c = b;
+				b = a;
+				a = _mm256_add_epi32(t1, t2);
+			}
+
+			__m256i result[8] = { a, b, c, d, e, f, g, h };
+			for(usize i = 0; i < 8; ++i)
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(state[i]), _mm256_add_epi32(v[i], result[i]));
+		}
+#endif
+
+		using CompressFunction = void (*)(u32* pState, const u8* pData, usize nBlocks);
+
+		CompressFunction selectCompress() {
+#ifdef JMMT_SHA256_X86
+			if(__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+				return compressShaNi;
+#endif
+			return compressScalar;
+		}
+
+		/// Returns true if many buffers should be hashed eight at a time with AVX2.
+		bool useAvx2MultiBuffer() {
+#ifdef JMMT_SHA256_X86
+			return __builtin_cpu_supports("avx2") && !__builtin_cpu_supports("sha");
+#else
+			return false;
+#endif
+		}
+
+		const CompressFunction compress = selectCompress();
+
+		/// Incremental SHA-256.
+		class Sha256 {
+			u32 state[8];
+			u8 buffer[BlockSize];
+			usize bufferSize = 0;
+			u64 size = 0;
+
+		   public:
+			Sha256() {
+				std::copy(std::begin(InitialState), std::end(InitialState), state);
+			}
+
+			void update(const u8* pData, usize length) {
+				size += length;
+
+				// Top up a partially filled block first.
+				if(bufferSize != 0) {
+					auto n = std::min(length, BlockSize - bufferSize);
+					std::memcpy(buffer + bufferSize, pData, n);
+					bufferSize += n;
+					pData += n;
+					length -= n;
+					if(bufferSize < BlockSize)
+						return;
+					compress(state, buffer, 1);
+					bufferSize = 0;
+				}
+
+				// Whole blocks are compressed straight from the input.
+				if(auto nBlocks = length / BlockSize; nBlocks != 0) {
+					compress(state, pData, nBlocks);
+					pData += nBlocks * BlockSize;
+					length -= nBlocks * BlockSize;
+				}
+
+				std::memcpy(buffer, pData, length);
+				bufferSize = length;
+			}
+
+			ShaDigest finish() {
+				u8 finalBlocks[BlockSize * 2];
+				auto nBlocks = makeFinalBlocks(finalBlocks, buffer, size);
+				compress(state, finalBlocks, nBlocks);
+				return makeDigest(state);
+			}
+		};
+
+#ifdef JMMT_SHA256_X86
+		/// Hashes [buffers] eight at a time. Each of the eight lanes works through one buffer; when a lane's
+		/// buffer is done, the lane moves on to the next buffer nobody has started yet.
+		void sha256DigestsAvx2(std::span<const std::span<const u8>> buffers, std::span<ShaDigest> digests) {
+			struct Lane {
+				usize buffer = 0;
+				bool active = false;
+				const u8* pData = nullptr;
+				usize dataBlocksLeft = 0;
+				u8 finalBlocks[BlockSize * 2];
+				usize finalBlocksLeft = 0;
+				usize finalBlock = 0;
+			};
+
+			constexpr static u8 IdleBlock[BlockSize] {};
+			u32 state[8][8];
+			Lane lanes[8];
+			usize nextBuffer = 0;
+
+			auto startLane = [&](usize laneIndex) {
+				auto& lane = lanes[laneIndex];
+				if(nextBuffer == buffers.size()) {
+					lane.active = false;
+					return;
+				}
+
+				auto data = buffers[nextBuffer];
+				lane.buffer = nextBuffer++;
+				lane.active = true;
+				lane.pData = data.data();
+				lane.dataBlocksLeft = data.size() / BlockSize;
+				lane.finalBlocksLeft = makeFinalBlocks(lane.finalBlocks, data.data() + lane.dataBlocksLeft * BlockSize, data.size());
+				lane.finalBlock = 0;
+				for(usize i = 0; i < 8; ++i)
+					state[i][laneIndex] = InitialState[i];
+			};
+
+			for(usize i = 0; i < 8; ++i)
+				startLane(i);
+
+			while(std::any_of(std::begin(lanes), std::end(lanes), [](const Lane& lane) { return lane.active; })) {
+				const u8* ppBlocks[8];
+				for(usize i = 0; i < 8; ++i) {
+					auto& lane = lanes[i];
+					if(!lane.active)
+						ppBlocks[i] = IdleBlock;
+					else if(lane.dataBlocksLeft != 0)
+						ppBlocks[i] = lane.pData;
+					else
+						ppBlocks[i] = lane.finalBlocks + lane.finalBlock * BlockSize;
+				}
+
+				compressAvx2x8(state, ppBlocks);
+
+				for(usize i = 0; i < 8; ++i) {
+					auto& lane = lanes[i];
+					if(!lane.active)
+						continue;
+
+					if(lane.dataBlocksLeft != 0) {
+						lane.pData += BlockSize;
+						--lane.dataBlocksLeft;
+						continue;
+					}
+
+					++lane.finalBlock;
+					if(--lane.finalBlocksLeft == 0) {
+						u32 laneState[8];
+						for(usize j = 0; j < 8; ++j)
+							laneState[j] = state[j][i];
+						digests[lane.buffer] = makeDigest(laneState);
+						startLane(i);
+					}
+				}
+			}
+		}
+#endif
+
+	} // namespace
+
+	ShaDigest sha256Digest(const u8* pData, usize size) {
+		Sha256 sha;
+		sha.update(pData, size);
+		return sha.finish();
+	}
+
+	ShaDigest sha256Digest(mco::Stream& stream) {
+		// A large buffer keeps the amount of (virtual) reads down; whole blocks are hashed straight out of it.
+		constexpr usize BufferSize = 1024 * 1024;
+		auto buffer = std::make_unique_for_overwrite<u8[]>(BufferSize);
+
+		Sha256 sha;
+		while(true) {
+			auto n = stream.read(buffer.get(), BufferSize);
+			if(n == 0)
+				break;
+			sha.update(buffer.get(), n);
+		}
+		return sha.finish();
+	}
+
+	void sha256Digests(std::span<const std::span<const u8>> buffers, std::span<ShaDigest> digests) {
+#ifdef JMMT_SHA256_X86
+		if(buffers.size() > 1 && useAvx2MultiBuffer()) {
+			sha256DigestsAvx2(buffers, digests);
+			return;
+		}
+#endif
+		for(usize i = 0; i < buffers.size(); ++i)
+			digests[i] = sha256Digest(buffers[i].data(), buffers[i].size());
+	}
+
+} // namespace jmmt::impl
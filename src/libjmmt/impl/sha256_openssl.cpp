@@ -1,4 +1,5 @@
 #include <jmmt/impl/sha256.hpp>
+#include <memory>
 #include <openssl/evp.h>
 
 namespace jmmt::impl {
@@ -13,22 +14,29 @@ namespace jmmt::impl {
 	}
 
 	ShaDigest sha256Digest(mco::Stream& stream) {
+		// A large buffer keeps the amount of (virtual) reads down.
+		constexpr usize BufferSize = 1024 * 1024;
 		ShaDigest digest{};
-		u8 buffer[1024]{};
+		auto buffer = std::make_unique_for_overwrite<u8[]>(BufferSize);
 
 		auto ctx = EVP_MD_CTX_new();
 
 		EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr);
 
 		while(true) {
-			auto n = stream.read(&buffer[0], sizeof(buffer));
+			auto n = stream.read(buffer.get(), BufferSize);
 			if(n == 0)
 				break;
-			EVP_DigestUpdate(ctx, &buffer[0], n);
+			EVP_DigestUpdate(ctx, buffer.get(), n);
 		}
 
 		EVP_DigestFinal_ex(ctx, &digest[0], nullptr);
 		EVP_MD_CTX_free(ctx);
 		return digest;
 	}
+
+	void sha256Digests(std::span<const std::span<const u8>> buffers, std::span<ShaDigest> digests) {
+		for(usize i = 0; i < buffers.size(); ++i)
+			digests[i] = sha256Digest(buffers[i].data(), buffers[i].size());
+	}
 }
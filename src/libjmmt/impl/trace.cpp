@@ -0,0 +1,122 @@
+#include <jmmt/trace.hpp>
+
+#ifdef JMMT_ENABLE_TRACING
+	#include <atomic>
+	#include <cstdio>
+	#include <cstdlib>
+	#include <mutex>
+	#include <string>
+	#include <vector>
+
+namespace jmmt::impl {
+
+	namespace {
+
+		struct TraceEvent {
+			const char* pName;
+			u32 threadId;
+			i64 startNs;
+			i64 durationNs;
+		};
+
+		/// Collects the events of every thread, and writes them out when the process exits.
+		class TraceRecorder {
+			std::string path;
+			std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+			std::mutex mutex;
+			std::vector<TraceEvent> events;
+			std::atomic<u32> nextThreadId = 1;
+
+			void write() {
+				auto* fp = std::fopen(path.c_str(), "w");
+				if(!fp)
+					return;
+
+				std::fprintf(fp, "{\"traceEvents\":[\n");
+				for(usize i = 0; i < events.size(); ++i) {
+					auto& event = events[i];
+					std::fprintf(fp, "{\"name\":\"%s\",\"cat\":\"jmmt\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+								 event.pName, event.threadId, event.startNs / 1000.0, event.durationNs / 1000.0,
+								 i + 1 < events.size() ? "," : "");
+				}
+				std::fprintf(fp, "],\"displayTimeUnit\":\"ns\"}\n");
+				std::fclose(fp);
+			}
+
+		   public:
+			explicit TraceRecorder(const char* pPath)
+				: path(pPath) {
+			}
+
+			~TraceRecorder() {
+				write();
+			}
+
+			i64 getTimestamp(std::chrono::steady_clock::time_point time) const {
+				return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch).count();
+			}
+
+			u32 allocateThreadId() {
+				return nextThreadId.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void submit(std::vector<TraceEvent>& threadEvents) {
+				std::lock_guard lock(mutex);
+				events.insert(events.end(), threadEvents.begin(), threadEvents.end());
+				threadEvents.clear();
+			}
+		};
+
+		TraceRecorder* getRecorder() {
+			// Only create a recorder (and thus, only write a trace) if asked to.
+			static auto recorder = []() -> Unique<TraceRecorder> {
+				if(auto* pPath = std::getenv("JMMT_TRACE"); pPath && *pPath)
+					return std::make_unique<TraceRecorder>(pPath);
+				return nullptr;
+			}();
+			return recorder.get();
+		}
+
+		/// Events are buffered per thread so recording a span doesn't need a lock,
+		/// and handed to the recorder in batches and when the thread exits.
+		struct ThreadEvents {
+			constexpr static usize BatchSize = 4096;
+
+			TraceRecorder* pRecorder;
+			u32 threadId;
+			std::vector<TraceEvent> events;
+
+			explicit ThreadEvents(TraceRecorder* pRecorder)
+				: pRecorder(pRecorder), threadId(pRecorder->allocateThreadId()) {
+				events.reserve(BatchSize);
+			}
+
+			~ThreadEvents() {
+				pRecorder->submit(events);
+			}
+		};
+
+	} // namespace
+
+	bool traceEnabled() {
+		return getRecorder() != nullptr;
+	}
+
+	void traceRecordSpan(const char* pName, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+		auto* pRecorder = getRecorder();
+		if(!pRecorder)
+			return;
+
+		thread_local ThreadEvents threadEvents(pRecorder);
+		threadEvents.events.push_back({ .pName = pName,
+										.threadId = threadEvents.threadId,
+										.startNs = pRecorder->getTimestamp(start),
+										.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() });
+
+		if(threadEvents.events.size() >= ThreadEvents::BatchSize)
+			pRecorder->submit(threadEvents.events);
+	}
+
+} // namespace jmmt::impl
+#endif
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <array>
+#include <jmmt/lzss/compress.hpp>
+
+// These must match decompress.cpp.
+#define LZSS_DEFAULT_RINGSIZE 512
+#define LZSS_DEFAULT_MATCHSIZE 66
+#define LZSS_THRESHOLD 2
+
+namespace jmmt::lzss {
+
+	namespace {
+
+		/// The decompressor starts writing the ring buffer here.
+		constexpr i32 RingStart = LZSS_DEFAULT_RINGSIZE - LZSS_DEFAULT_MATCHSIZE;
+
+		/// Matches can reach back almost a whole ring. (The byte a full ring back is
+		/// about to be overwritten by the first byte of the match.)
+		constexpr i32 MaxDistance = LZSS_DEFAULT_RINGSIZE - 1;
+
+		/// A match has to be longer than the threshold to be worth encoding.
+		constexpr i32 MinMatch = LZSS_THRESHOLD + 1;
+		constexpr i32 MaxMatch = LZSS_DEFAULT_MATCHSIZE;
+
+		/// How many earlier positions are tried when looking for a match.
+		constexpr i32 MaxChainLength = 64;
+
+		constexpr i32 HashBits = 12;
+
+		u32 hash3(const u8* p) {
+			return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & ((1 << HashBits) - 1);
+		}
+
+		/// Writes items, and the flag bytes which precede every 8 of them.
+		class Writer {
+			u8* output;
+			i32 capacity;
+			i32 position = 0;
+			i32 flagPosition = -1;
+			u32 nItems = 0;
+
+			bool put(u8 byte) {
+				if(position >= capacity)
+					return false;
+				output[position++] = byte;
+				return true;
+			}
+
+			bool beginItem(bool literal) {
+				if(nItems % 8 == 0) {
+					flagPosition = position;
+					if(!put(0))
+						return false;
+				}
+
+				// A set flag bit means a literal byte.
+				if(literal)
+					output[flagPosition] |= 1 << (nItems % 8);
+				++nItems;
+				return true;
+			}
+
+		   public:
+			Writer(u8* output, i32 capacity)
+				: output(output), capacity(capacity) {
+			}
+
+			bool literal(u8 byte) {
+				return beginItem(true) && put(byte);
+			}
+
+			/// Encodes a match of [length] bytes, copied from [ringIndex] in the ring buffer.
+			/// The 9th bit of the ring index goes in the top bit of the length byte.
+			bool match(i32 ringIndex, i32 length) {
+				return beginItem(false)
+					&& put(static_cast<u8>(ringIndex & 0xff))
+					&& put(static_cast<u8>(((ringIndex >> 8) << 7) | (length - MinMatch)));
+			}
+
+			i32 getSize() const {
+				return position;
+			}
+		};
+
+	} // namespace
+
+	i32 compress(const u8* input, i32 inputLength, u8* output, i32 outputCapacity) {
+		// Hash chains of earlier positions with the same first 3 bytes.
+		// Only positions within the ring are ever followed, so [prev] only needs to hold one ring's worth.
+		std::array<i32, 1 << HashBits> head;
+		std::array<i32, LZSS_DEFAULT_RINGSIZE> prev;
+		head.fill(-1);
+
+		auto insert = [&](i32 position) {
+			if(position + MinMatch > inputLength)
+				return;
+			auto& h = head[hash3(&input[position])];
+			prev[position & (LZSS_DEFAULT_RINGSIZE - 1)] = h;
+			h = position;
+		};
+
+		Writer writer(output, outputCapacity);
+		i32 position = 0;
+		while(position < inputLength) {
+			i32 bestLength = 0;
+			i32 bestPosition = 0;
+
+			if(position + MinMatch <= inputLength) {
+				auto maxLength = std::min(MaxMatch, inputLength - position);
+				auto candidate = head[hash3(&input[position])];
+				for(i32 chain = 0; candidate != -1 && position - candidate <= MaxDistance && chain < MaxChainLength; ++chain) {
+					// Matches may overlap the bytes they produce, like the decompressor's copy does.
+					i32 length = 0;
+					while(length < maxLength && input[candidate + length] == input[position + length])
+						++length;
+
+					if(length > bestLength) {
+						bestLength = length;
+						bestPosition = candidate;
+						if(length == maxLength)
+							break;
+					}
+
+					candidate = prev[candidate & (LZSS_DEFAULT_RINGSIZE - 1)];
+				}
+			}
+
+			if(bestLength >= MinMatch) {
+				// Input byte N is written to ring index (RingStart + N) by the decompressor.
+				if(!writer.match((RingStart + bestPosition) & (LZSS_DEFAULT_RINGSIZE - 1), bestLength))
+					return -1;
+				for(i32 i = 0; i < bestLength; ++i)
+					insert(position + i);
+				position += bestLength;
+			} else {
+				if(!writer.literal(input[position]))
+					return -1;
+				insert(position);
+				++position;
+			}
+		}
+
+		return writer.getSize();
+	}
+
+} // namespace jmmt::lzss
@@ -1,5 +1,6 @@
 #include <cstring>
 #include <jmmt/lzss/decompress.hpp>
+#include <jmmt/trace.hpp>
 
 #define LZSS_DEFAULT_RINGSIZE 512
 #define LZSS_DEFAULT_MATCHSIZE 66
@@ -33,6 +34,7 @@
 namespace jmmt::lzss {
 
 	int decompress(structs::LzssHeader* header, const u8* compressedInput, i32 compressedLength, u8* destBuffer) {
+		JMMT_TRACE_SCOPE("lzss::decompress");
 		int32_t nRingIndex, nInSize, nInputBufferIndex, nRingBits, nRingSize;
 		uint8_t aRingBuffer[LZSS_DEFAULT_RINGSIZE], *pRingBuffer;
 		uint32_t nBitFlags = 0;
@@ -1,6 +1,7 @@
 #include <array>
 #include <cstring>
 #include <jmmt/ps2/vif.hpp>
+#include <jmmt/trace.hpp>
 
 namespace jmmt::ps2 {
 
@@ -48,6 +49,7 @@ namespace jmmt::ps2 {
 	}
 
 	void Vif::execute(const u8* pTags, u32 tagBufferLength, u8* pUnpackData, u32 unpackLength) {
+		JMMT_TRACE_SCOPE("Vif::execute");
 		this->pInput = pTags;
 		this->inputLength = tagBufferLength;
 		this->pOutput = pUnpackData;
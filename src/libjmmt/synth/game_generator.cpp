@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <jmmt/fs/pak_writer.hpp>
+#include <jmmt/synth/game_generator.hpp>
+
+namespace jmmt::synth {
+
+	namespace {
+
+		const char* TypeNames[] = { "Texture", "Model", "Sound", "Script" };
+
+		/// splitmix64. Used instead of <random> so that generated data is the same everywhere.
+		class Random {
+			u64 state;
+
+		   public:
+			explicit Random(u64 seed)
+				: state(seed) {
+			}
+
+			u64 next() {
+				u64 z = (state += 0x9e3779b97f4a7c15);
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+				return z ^ (z >> 31);
+			}
+
+			/// Returns a number in [min, max].
+			u32 range(u32 min, u32 max) {
+				return min + static_cast<u32>(next() % (static_cast<u64>(max - min) + 1));
+			}
+
+			/// Returns a number in [0, 1).
+			float unit() {
+				return static_cast<float>(next() >> 40) / static_cast<float>(1 << 24);
+			}
+		};
+
+		Random makeFileRandom(const PackageOptions& package, u32 fileIndex, u64 stream) {
+			return Random((static_cast<u64>(package.seed) << 32 | fileIndex) ^ (stream * 0xd1b54a32d192ed03));
+		}
+
+		std::string getSourceName(u32 fileIndex) {
+			return std::format("c:\\synth\\source\\file{:07}.src", fileIndex);
+		}
+
+	} // namespace
+
+	std::string getFileName(const PackageOptions& package, u32 fileIndex) {
+		return std::format("synth\\{}\\file{:07}.bin", std::filesystem::path(package.name).stem().string(), fileIndex);
+	}
+
+	u32 getFileSize(const PackageOptions& package, u32 fileIndex) {
+		auto random = makeFileRandom(package, fileIndex, 0);
+		return random.range(package.minFileSize, std::max(package.minFileSize, package.maxFileSize));
+	}
+
+	std::vector<u8> getFileData(const PackageOptions& package, u32 fileIndex) {
+		std::vector<u8> data(getFileSize(package, fileIndex));
+		auto random = makeFileRandom(package, fileIndex, 1);
+
+		// With probability [compressibility], copy a run of earlier data (which LZSS can encode as a match);
+		// otherwise, emit a random byte (which it can't).
+		usize i = 0;
+		while(i < data.size()) {
+			if(i >= 4 && random.unit() < package.compressibility) {
+				auto distance = std::min<usize>(random.range(1, 64), i);
+				auto length = std::min<usize>(random.range(4, 64), data.size() - i);
+				for(usize j = 0; j < length; ++j, ++i)
+					data[i] = data[i - distance];
+			} else {
+				data[i++] = static_cast<u8>(random.next());
+			}
+		}
+
+		return data;
+	}
+
+	bool writePackage(const std::filesystem::path& path, const PackageOptions& package, fs::PackageMetadata& metadata) {
+		fs::PakWriter writer;
+		writer.setGroupName(package.name);
+
+		for(u32 i = 0; i < package.fileCount; ++i) {
+			auto source = [&package, i](std::span<u8> out) {
+				auto data = getFileData(package, i);
+				std::memcpy(out.data(), data.data(), out.size());
+				return true;
+			};
+
+			writer.addFile(getFileName(package, i), getFileSize(package, i), std::move(source),
+						   { .typeName = TypeNames[i % std::size(TypeNames)],
+							 .sourceName = getSourceName(i),
+							 .dateStamp = 0x20250000 | (package.seed & 0xffff) });
+		}
+
+		// Extra strings aren't used by any file; they only make the string table bigger.
+		for(u32 i = 0; i < package.extraStrings; ++i)
+			writer.addString(std::format("c:\\synth\\unused\\string{:07}", i));
+
+		return writer.write(path, metadata) == fs::PakWriter::Success;
+	}
+
+	bool generateGameFileSystem(const std::filesystem::path& root, const GameOptions& options) {
+		std::error_code ec;
+		for(auto* pFolder : { "DATA", "IRX", "MOVIES", "MUSIC" }) {
+			std::filesystem::create_directories(root / pFolder, ec);
+			if(ec)
+				return false;
+		}
+
+		// Start from an empty package.toc, so that packages from an earlier generation don't stick around.
+		auto tocPath = root / "DATA" / "package.toc";
+		std::filesystem::remove(tocPath, ec);
+
+		for(auto& package : options.packages) {
+			fs::PackageMetadata metadata {};
+			if(!writePackage(root / "DATA" / package.name, package, metadata) || !fs::updatePackageToc(tocPath, package.name, metadata))
+				return false;
+		}
+
+		return true;
+	}
+
+} // namespace jmmt::synth
@@ -0,0 +1,94 @@
+#include <jmmt/crc.hpp>
+#include <mco/nounit.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+// The faster hashing paths need to give bit-identical results to the game's byte at a time hash,
+// since every file name lookup depends on them.
+
+namespace {
+
+	u32 referenceHash(std::string_view str, bool foldCase) {
+		u32 crc = 0;
+		for(char c : str) {
+			// Same table as the library uses, built from the reflected polynomial.
+			u32 value = (crc ^ (foldCase ? (c & ~0x20) : c)) & 0xff;
+			for(u32 bit = 0; bit < 8; ++bit)
+				value = (value & 1) ? (value >> 1) ^ 0xedb88320 : value >> 1;
+			crc = value ^ (crc >> 8);
+		}
+		return crc;
+	}
+
+	/// Random bytes, covering every byte value (so the case fold is tested on non-letters, too).
+	std::string makeRandomString(std::mt19937& random, usize length) {
+		std::string str(length, '\0');
+		for(auto& c : str)
+			c = static_cast<char>(random() & 0xff);
+		return str;
+	}
+
+} // namespace
+
+mcoNoUnitDeclareTest(crcMatchesReference, "string hashes match the byte at a time hash at every length and alignment") {
+	std::mt19937 random(1234);
+	auto data = makeRandomString(random, 5000);
+
+	// Lengths around the slicing and carry-less multiply thresholds are the interesting ones.
+	for(usize length = 0; length < 1100; length += (length < 300 ? 1 : 37)) {
+		for(usize offset = 0; offset < 8; ++offset) {
+			auto str = std::string_view(data).substr(offset, length);
+			mcoNoUnitAssert(jmmt::hashString(str) == referenceHash(str, true));
+			mcoNoUnitAssert(jmmt::hashStringCase(str) == referenceHash(str, false));
+		}
+	}
+
+	auto str = std::string_view(data);
+	mcoNoUnitAssert(jmmt::hashString(str) == referenceHash(str, true));
+	mcoNoUnitAssert(jmmt::hashStringCase(str) == referenceHash(str, false));
+	mcoNoUnitAssert(jmmt::hashString("data\\texture.bin") == jmmt::hashString("DATA\\Texture.BIN"));
+}
+
+mcoNoUnitDeclareTest(crcBatchMatchesSingle, "batch string hashes match hashing strings one at a time") {
+	std::mt19937 random(5678);
+	std::vector<std::string> strings;
+	for(u32 i = 0; i < 103; ++i)
+		strings.push_back(makeRandomString(random, random() % (i % 10 == 0 ? 400 : 48)));
+
+	std::vector<std::string_view> views(strings.begin(), strings.end());
+	std::vector<jmmt::Crc32Result> hashes(views.size());
+	std::vector<jmmt::Crc32Result> caseHashes(views.size());
+	jmmt::hashStrings(views, hashes);
+	jmmt::hashStringsCase(views, caseHashes);
+
+	for(usize i = 0; i < views.size(); ++i) {
+		mcoNoUnitAssert(hashes[i] == jmmt::hashString(views[i]));
+		mcoNoUnitAssert(caseHashes[i] == jmmt::hashStringCase(views[i]));
+	}
+}
+
+mcoNoUnitDeclareTest(crcConstexprMatchesRuntime, "compile time string hashes match runtime hashes") {
+	using namespace jmmt::literals;
+
+	// These are constant expressions; if they weren't, this wouldn't compile.
+	constexpr auto tocHash = jmmt::NameHash<"package.toc">;
+	constexpr auto caseHash = jmmt::hashStringCase("Package.toc");
+	static_assert("PACKAGE.TOC"_hash == tocHash);
+
+	// The runtime hashes come from a volatile string so they can't be constant folded.
+	volatile char name[] = "Package.toc";
+	auto runtimeName = std::string(const_cast<char*>(name));
+	mcoNoUnitAssert(jmmt::hashString(runtimeName) == tocHash);
+	mcoNoUnitAssert(jmmt::hashStringCase(runtimeName) == caseHash);
+	mcoNoUnitAssert(caseHash == referenceHash("Package.toc", false));
+
+	switch(jmmt::hashString(runtimeName)) {
+		case "package.toc"_hash:
+			break;
+		default:
+			mcoNoUnitAssert(false);
+	}
+}
+
+mcoNoUnitMain();
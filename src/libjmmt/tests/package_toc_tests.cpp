@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/package_toc.hpp>
+#include <mco/nounit.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+	std::filesystem::path makeTestRoot(const char* pName) {
+		auto root = std::filesystem::temp_directory_path() / std::format("jmmt_{}_{}", pName, std::rand());
+		std::filesystem::remove_all(root);
+		std::filesystem::create_directories(root);
+		return root;
+	}
+
+	void writeFile(const std::filesystem::path& path, const std::vector<u8>& data) {
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+} // namespace
+
+mcoNoUnitDeclareTest(packageTocLoads, "package.toc entries are found by name, and later entries replace earlier ones") {
+	auto root = makeTestRoot("package_toc");
+
+	auto makeEntry = [](std::string_view name, u32 nameHash, u32 fileCount) {
+		jmmt::structs::PackageTocHeader entry {};
+		std::copy(name.begin(), name.end(), entry.fileName);
+		entry.filenameHash = nameHash;
+		entry.tocFileCount = fileCount;
+		return entry;
+	};
+
+	// A name filling the whole field has no terminator, and a name with a bogus hash still has to be found.
+	auto longName = std::string(sizeof(jmmt::structs::PackageTocHeader::fileName), 'L');
+	jmmt::structs::PackageTocHeader entries[] = {
+		makeEntry("A.PAK", jmmt::hashString("A.PAK"), 1),
+		makeEntry("B.PAK", 0, 2),
+		makeEntry(longName, jmmt::hashString(longName), 3),
+		makeEntry("A.PAK", jmmt::hashString("A.PAK"), 4)
+	};
+	auto* pEntryBytes = reinterpret_cast<const u8*>(&entries[0]);
+	writeFile(root / "package.toc", { pEntryBytes, pEntryBytes + sizeof(entries) });
+
+	jmmt::fs::PackageToc toc;
+	mcoNoUnitAssert(toc.load(root / "package.toc"));
+	mcoNoUnitAssert(toc.size() == 3);
+	mcoNoUnitAssert(toc.find("A.PAK") && toc.find("A.PAK")->nrPackageFiles == 4);
+	mcoNoUnitAssert(toc.find("B.PAK") && toc.find("B.PAK")->nrPackageFiles == 2);
+	mcoNoUnitAssert(toc.find(longName) && toc.find(longName)->nrPackageFiles == 3);
+	mcoNoUnitAssert(!toc.find("C.PAK"));
+
+	std::vector<std::string_view> names;
+	for(auto& [name, _] : toc)
+		names.push_back(name);
+	mcoNoUnitAssert((names == std::vector<std::string_view> { "B.PAK", longName, "A.PAK" }));
+
+	// Entries point into the table itself, so it can only be moved, which keeps them valid.
+	static_assert(!std::is_copy_constructible_v<jmmt::fs::PackageToc>);
+	auto moved = std::move(toc);
+	mcoNoUnitAssert(moved.find(longName) && moved.find(longName)->nrPackageFiles == 3);
+	mcoNoUnitAssert(moved.begin()->name == "B.PAK");
+
+	mcoNoUnitAssert(!toc.load(root / "missing.toc"));
+	mcoNoUnitAssert(toc.size() == 0);
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitMain();
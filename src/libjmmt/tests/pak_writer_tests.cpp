@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/game_filesystem.hpp>
+#include <jmmt/fs/pak_writer.hpp>
+#include <jmmt/synth/game_generator.hpp>
+#include <mco/nounit.hpp>
+#include <vector>
+
+namespace {
+
+	std::filesystem::path makeTestRoot(const char* pName) {
+		auto root = std::filesystem::temp_directory_path() / std::format("jmmt_{}_{}", pName, std::rand());
+		std::filesystem::remove_all(root);
+		std::filesystem::create_directories(root);
+		return root;
+	}
+
+	std::vector<u8> readFile(const std::filesystem::path& path) {
+		std::ifstream stream(path, std::ios::binary);
+		return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+	}
+
+	void writeFile(const std::filesystem::path& path, const std::vector<u8>& data) {
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	const jmmt::synth::PackageOptions SourcePackage {
+		.name = "SOURCE.PAK",
+		.fileCount = 20,
+		.minFileSize = 0,
+		.maxFileSize = 300 * 1024,
+		.compressibility = 0.6f,
+		.seed = 42
+	};
+
+	/// Writes the files of [SourcePackage] into a package at [path] on [nThreads] threads.
+	jmmt::fs::PakWriter::Error writeSourcePackage(const std::filesystem::path& path, u32 nThreads, jmmt::fs::PackageMetadata& metadata) {
+		jmmt::fs::PakWriter writer;
+		writer.setThreadCount(nThreads);
+		for(u32 i = 0; i < SourcePackage.fileCount; ++i)
+			writer.addFile(jmmt::synth::getFileName(SourcePackage, i), jmmt::synth::getFileData(SourcePackage, i));
+		return writer.write(path, metadata);
+	}
+
+} // namespace
+
+mcoNoUnitDeclareTest(outputIsDeterministic, "pak writer output doesn't depend on thread count") {
+	auto root = makeTestRoot("pak_writer_determinism");
+	jmmt::fs::PackageMetadata metadata1 {};
+	jmmt::fs::PackageMetadata metadata8 {};
+	std::filesystem::create_directories(root / "one");
+	std::filesystem::create_directories(root / "eight");
+	mcoNoUnitAssert(writeSourcePackage(root / "one" / "TEST.PAK", 1, metadata1) == jmmt::fs::PakWriter::Success);
+	mcoNoUnitAssert(writeSourcePackage(root / "eight" / "TEST.PAK", 8, metadata8) == jmmt::fs::PakWriter::Success);
+
+	auto data1 = readFile(root / "one" / "TEST.PAK");
+	mcoNoUnitAssert(!data1.empty());
+	mcoNoUnitAssert(data1 == readFile(root / "eight" / "TEST.PAK"));
+	mcoNoUnitAssert(metadata1.chunkDataSize == metadata8.chunkDataSize);
+	mcoNoUnitAssert(metadata1.nrPackageFiles == SourcePackage.fileCount);
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(duplicateNamesAreRejected, "pak writer rejects files with the same name") {
+	auto root = makeTestRoot("pak_writer_duplicates");
+	jmmt::fs::PakWriter writer;
+	writer.addFile("data\\file.bin", std::vector<u8>(10));
+	writer.addFile("DATA\\FILE.BIN", std::vector<u8>(20));
+
+	jmmt::fs::PackageMetadata metadata {};
+	mcoNoUnitAssert(writer.write(root / "DUP.PAK", metadata) == jmmt::fs::PakWriter::DuplicateFile);
+	mcoNoUnitAssert(!std::filesystem::exists(root / "DUP.PAK"));
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(failedWritesLeaveNothing, "pak writer leaves no files behind when writing fails") {
+	auto root = makeTestRoot("pak_writer_failure");
+	jmmt::fs::PakWriter writer;
+	writer.addFile("data\\good.bin", std::vector<u8>(10));
+	writer.addFile("data\\bad.bin", 100, [](std::span<u8>) { return false; });
+
+	jmmt::fs::PackageMetadata metadata {};
+	mcoNoUnitAssert(writer.write(root / "BAD.PAK", metadata) != jmmt::fs::PakWriter::Success);
+	mcoNoUnitAssert(std::filesystem::is_empty(root));
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(directoryRoundTrips, "a package written from a directory reads back through the package filesystem") {
+	auto root = makeTestRoot("pak_writer_directory");
+	auto sourceDirectory = root / "source";
+	for(u32 i = 0; i < SourcePackage.fileCount; ++i)
+		writeFile(sourceDirectory / std::format("dir{}", i % 3) / std::format("file{}.bin", i), jmmt::synth::getFileData(SourcePackage, i));
+
+	// Make an (otherwise empty) game root to put the package in.
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root / "game", {}));
+
+	// Dangling symlinks aren't files, so they're left out.
+	std::error_code ec;
+	std::filesystem::create_symlink(root / "nowhere", sourceDirectory / "dangling", ec);
+
+	jmmt::fs::PakWriter writer;
+	mcoNoUnitAssert(writer.addDirectory(sourceDirectory));
+	mcoNoUnitAssert(writer.getFileCount() == SourcePackage.fileCount);
+
+	// Entries which can't be looked at fail listing the directory, instead of throwing.
+	auto loopDirectory = root / "loop";
+	std::filesystem::create_directories(loopDirectory);
+	std::filesystem::create_symlink(loopDirectory / "loop", loopDirectory / "loop", ec);
+	if(!ec) {
+		jmmt::fs::PakWriter loopWriter;
+		mcoNoUnitAssert(!loopWriter.addDirectory(loopDirectory));
+	}
+
+	jmmt::fs::PackageMetadata metadata {};
+	mcoNoUnitAssert(writer.write(root / "game" / "DATA" / "DIR.PAK", metadata) == jmmt::fs::PakWriter::Success);
+	mcoNoUnitAssert(jmmt::fs::updatePackageToc(root / "game" / "DATA" / "package.toc", "DIR.PAK", metadata));
+
+	auto fs = jmmt::fs::createGameFileSystem(root / "game", jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+	auto pak = fs->openPackageFile("DIR.PAK");
+	mcoNoUnitAssert(pak != nullptr);
+
+	for(u32 i = 0; i < SourcePackage.fileCount; ++i) {
+		auto expected = jmmt::synth::getFileData(SourcePackage, i);
+		auto handle = pak->fileOpen(std::format("dir{}\\file{}.bin", i % 3, i));
+		mcoNoUnitAssert(handle >= 0);
+
+		std::vector<u8> data(expected.size());
+		mcoNoUnitAssert(pak->fileRead(handle, data.data(), static_cast<u32>(data.size())) == static_cast<i32>(data.size()));
+		mcoNoUnitAssert(data == expected);
+		pak->fileClose(handle);
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(updateAppendsAndCompacts, "updating a package keeps unchanged data in place, and compaction reclaims the rest") {
+	auto root = makeTestRoot("pak_writer_update");
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, {}));
+	auto pakPath = root / "DATA" / "UPDATE.PAK";
+	auto tocPath = root / "DATA" / "package.toc";
+
+	jmmt::fs::PackageMetadata original {};
+	mcoNoUnitAssert(writeSourcePackage(pakPath, 0, original) == jmmt::fs::PakWriter::Success);
+	auto originalData = readFile(pakPath);
+
+	// Replace file 3, remove file 4, and add a new file.
+	auto replacedData = std::vector<u8>(100 * 1024, 0x55);
+	auto addedData = jmmt::synth::getFileData(SourcePackage, 5);
+	jmmt::fs::PakUpdater updater;
+	updater.addFile(jmmt::synth::getFileName(SourcePackage, 3), replacedData);
+	updater.addFile("synth\\added.bin", addedData);
+	updater.removeFile(jmmt::synth::getFileName(SourcePackage, 4));
+
+	jmmt::fs::PackageMetadata updated {};
+	mcoNoUnitAssert(updater.update(pakPath, original, updated) == jmmt::fs::PakWriter::Success);
+	mcoNoUnitAssert(updated.nrPackageFiles == SourcePackage.fileCount);
+	mcoNoUnitAssert(updated.chunkStartOffset >= originalData.size());
+
+	// Nothing the original header refers to was touched.
+	auto updatedData = readFile(pakPath);
+	mcoNoUnitAssert(std::equal(originalData.begin(), originalData.end(), updatedData.begin()));
+
+	auto checkFiles = [&](const jmmt::fs::PackageMetadata& metadata) {
+		mcoNoUnitAssert(jmmt::fs::updatePackageToc(tocPath, "UPDATE.PAK", metadata));
+		auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+		mcoNoUnitAssert(fs != nullptr);
+		auto pak = fs->openPackageFile("UPDATE.PAK");
+		mcoNoUnitAssert(pak != nullptr);
+
+		auto checkFile = [&](const std::string& name, const std::vector<u8>& expected) {
+			auto handle = pak->fileOpen(name);
+			mcoNoUnitAssert(handle >= 0);
+			std::vector<u8> data(expected.size());
+			mcoNoUnitAssert(pak->fileRead(handle, data.data(), static_cast<u32>(data.size())) == static_cast<i32>(data.size()));
+			mcoNoUnitAssert(data == expected);
+			pak->fileClose(handle);
+		};
+
+		for(u32 i = 0; i < SourcePackage.fileCount; ++i) {
+			if(i == 3)
+				checkFile(jmmt::synth::getFileName(SourcePackage, i), replacedData);
+			else if(i == 4)
+				mcoNoUnitAssert(pak->fileOpen(jmmt::synth::getFileName(SourcePackage, i)) < 0);
+			else
+				checkFile(jmmt::synth::getFileName(SourcePackage, i), jmmt::synth::getFileData(SourcePackage, i));
+		}
+		checkFile("synth\\added.bin", addedData);
+	};
+	checkFiles(updated);
+
+	jmmt::fs::PackageMetadata compacted {};
+	mcoNoUnitAssert(jmmt::fs::compactPackage(pakPath, updated, compacted) == jmmt::fs::PakWriter::Success);
+	mcoNoUnitAssert(compacted.chunkStartOffset == 0);
+	mcoNoUnitAssert(std::filesystem::file_size(pakPath) < updatedData.size());
+	checkFiles(compacted);
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(reorderFollowsTrace, "reordering a package by an access trace makes the trace's reads sequential") {
+	auto root = makeTestRoot("pak_writer_reorder");
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, {}));
+	auto pakPath = root / "DATA" / "REORDER.PAK";
+
+	jmmt::fs::PackageMetadata original {};
+	mcoNoUnitAssert(writeSourcePackage(pakPath, 0, original) == jmmt::fs::PakWriter::Success);
+
+	// Read every third file, backwards: the opposite of the order they were written in.
+	jmmt::fs::AccessTrace trace;
+	for(u32 i = SourcePackage.fileCount; i-- > 0;)
+		if(i % 3 == 0)
+			trace.entries.push_back({ .fileName = jmmt::synth::getFileName(SourcePackage, i), .offset = 0, .length = jmmt::synth::getFileSize(SourcePackage, i), .timestamp = {} });
+
+	jmmt::fs::SeekReport before {};
+	mcoNoUnitAssert(jmmt::fs::computeSeekReport(pakPath, original, trace, before));
+	mcoNoUnitAssert(before.seeks > 0);
+
+	jmmt::fs::PackageMetadata reordered {};
+	mcoNoUnitAssert(jmmt::fs::reorderPackage(pakPath, original, reordered, jmmt::fs::getTraceFileOrder(trace)) == jmmt::fs::PakWriter::Success);
+
+	jmmt::fs::SeekReport after {};
+	mcoNoUnitAssert(jmmt::fs::computeSeekReport(pakPath, reordered, trace, after));
+	mcoNoUnitAssert(after.seeks == 0);
+	mcoNoUnitAssert(after.chunkReads == before.chunkReads && after.bytesRead == before.bytesRead);
+
+	// Compacting keeps the new order.
+	jmmt::fs::PackageMetadata compacted {};
+	mcoNoUnitAssert(jmmt::fs::compactPackage(pakPath, reordered, compacted) == jmmt::fs::PakWriter::Success);
+	mcoNoUnitAssert(jmmt::fs::computeSeekReport(pakPath, compacted, trace, after));
+	mcoNoUnitAssert(after.seeks == 0);
+
+	mcoNoUnitAssert(jmmt::fs::updatePackageToc(root / "DATA" / "package.toc", "REORDER.PAK", compacted));
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+	auto pak = fs->openPackageFile("REORDER.PAK");
+	mcoNoUnitAssert(pak != nullptr);
+	for(u32 i = 0; i < SourcePackage.fileCount; ++i)
+		mcoNoUnitAssert(pak->readWholeFile(jmmt::synth::getFileName(SourcePackage, i)) == jmmt::synth::getFileData(SourcePackage, i));
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitMain();
@@ -0,0 +1,44 @@
+#include <jmmt/impl/hex_buffer.hpp>
+#include <jmmt/impl/sha256.hpp>
+#include <mco/nounit.hpp>
+#include <string_view>
+#include <vector>
+
+// Whichever SHA-256 path the CPU ends up on has to agree with the FIPS 180-4 test vectors,
+// since version detection compares against known digests.
+
+namespace {
+
+	jmmt::impl::ShaDigest digestOf(std::string_view str) {
+		return jmmt::impl::sha256Digest(reinterpret_cast<const u8*>(str.data()), str.size());
+	}
+
+} // namespace
+
+mcoNoUnitDeclareTest(sha256MatchesTestVectors, "sha256 digests match the standard test vectors") {
+	mcoNoUnitAssert(digestOf("") == jmmt::impl::hexToBuffer<"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855">());
+	mcoNoUnitAssert(digestOf("abc") == jmmt::impl::hexToBuffer<"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad">());
+	mcoNoUnitAssert(digestOf("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == jmmt::impl::hexToBuffer<"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1">());
+
+	std::string million(1000000, 'a');
+	mcoNoUnitAssert(digestOf(million) == jmmt::impl::hexToBuffer<"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0">());
+}
+
+mcoNoUnitDeclareTest(sha256BatchMatchesSingle, "batch sha256 digests match hashing buffers one at a time") {
+	// Lengths either side of the padding boundaries, and a few multi-block ones, so lanes finish at different times.
+	std::vector<u8> data(20000);
+	for(usize i = 0; i < data.size(); ++i)
+		data[i] = static_cast<u8>(i * 131 + (i >> 8));
+
+	std::vector<std::span<const u8>> buffers;
+	for(usize length : { 0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 4096, 19999, 20000 })
+		for(usize offset = 0; offset < 3; ++offset)
+			buffers.emplace_back(data.data() + offset, length - (length == 20000 ? offset : 0));
+
+	std::vector<jmmt::impl::ShaDigest> digests(buffers.size());
+	jmmt::impl::sha256Digests(buffers, digests);
+	for(usize i = 0; i < buffers.size(); ++i)
+		mcoNoUnitAssert(digests[i] == jmmt::impl::sha256Digest(buffers[i].data(), buffers[i].size()));
+}
+
+mcoNoUnitMain();
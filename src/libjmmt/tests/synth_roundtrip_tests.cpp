@@ -0,0 +1,458 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/game_filesystem.hpp>
+#include <jmmt/fs/overlay_filesystem.hpp>
+#include <jmmt/lzss/compress.hpp>
+#include <jmmt/lzss/decompress.hpp>
+#include <jmmt/synth/game_generator.hpp>
+#include <libjmmt/fs/pak_index.hpp>
+#include <mco/io/file_stream.hpp>
+#include <mco/nounit.hpp>
+#include <thread>
+#include <vector>
+
+// These tests generate a synthetic game filesystem, and check that libjmmt reads back
+// exactly what the generator wrote.
+
+namespace {
+
+	std::filesystem::path makeTestRoot(const char* pName) {
+		auto root = std::filesystem::temp_directory_path() / std::format("jmmt_{}_{}", pName, std::rand());
+		std::filesystem::remove_all(root);
+		return root;
+	}
+
+	jmmt::synth::PackageOptions makePackageOptions(const char* pName, float compressibility) {
+		return {
+			.name = pName,
+			.fileCount = 50,
+			.minFileSize = 0,
+			.maxFileSize = 200 * 1024,
+			.compressibility = compressibility,
+			.extraStrings = 10,
+			.seed = 1234
+		};
+	}
+
+	/// Reads every file of [package] and compares it against the generated data.
+	bool checkPackage(Ref<jmmt::fs::PakFileSystem> pak, const jmmt::synth::PackageOptions& package) {
+		if(pak->enumerateFiles().size() != package.fileCount)
+			return false;
+
+		for(u32 i = 0; i < package.fileCount; ++i) {
+			auto expected = jmmt::synth::getFileData(package, i);
+			auto handle = pak->fileOpen(jmmt::synth::getFileName(package, i));
+			if(handle < 0)
+				return false;
+
+			std::vector<u8> data(expected.size());
+			auto n = pak->fileRead(handle, data.data(), static_cast<u32>(data.size()));
+			pak->fileClose(handle);
+			if(n != static_cast<i32>(expected.size()) || data != expected)
+				return false;
+		}
+
+		return true;
+	}
+
+} // namespace
+
+mcoNoUnitDeclareTest(lzssRoundTrips, "lzss compress output decompresses to its input") {
+	jmmt::synth::PackageOptions package { .compressibility = 0.8f };
+	for(u32 i = 0; i < 20; ++i) {
+		auto data = jmmt::synth::getFileData(package, i);
+		std::vector<u8> compressed(jmmt::lzss::getMaxCompressedSize(static_cast<i32>(data.size())));
+		auto compressedSize = jmmt::lzss::compress(data.data(), static_cast<i32>(data.size()), compressed.data(), static_cast<i32>(compressed.size()));
+		mcoNoUnitAssert(compressedSize >= 0);
+
+		std::vector<u8> decompressed(data.size());
+		jmmt::lzss::decompress(nullptr, compressed.data(), compressedSize, decompressed.data());
+		mcoNoUnitAssert(decompressed == data);
+	}
+}
+
+mcoNoUnitDeclareTest(syntheticFilesystemRoundTrips, "synthetic filesystem reads back what was generated") {
+	auto root = makeTestRoot("synth_roundtrip");
+	jmmt::synth::GameOptions options {
+		.packages = {
+		makePackageOptions("RANDOM.PAK", 0.0f),
+		makePackageOptions("MIXED.PAK", 0.5f),
+		makePackageOptions("REPETITIVE.PAK", 1.0f) }
+	};
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, options));
+
+	// There's no game ELF, so detection has to fail without an assumed version.
+	mcoNoUnitAssert(jmmt::fs::createGameFileSystem(root) == nullptr);
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+	mcoNoUnitAssert(fs->getPackageMetadata().size() == options.packages.size());
+
+	for(auto& package : options.packages) {
+		auto eager = fs->openPackageFile(package.name);
+		mcoNoUnitAssert(eager != nullptr);
+		mcoNoUnitAssert(checkPackage(eager, package));
+
+		// Metadata built lazily is charged to the memory budget, like the rest of the index.
+		auto lazy = fs->openPackageFile(package.name, jmmt::fs::PakFileSystem::InitLazy);
+		mcoNoUnitAssert(lazy != nullptr);
+		auto memoryInUse = fs->getStats().memoryInUse;
+		mcoNoUnitAssert(lazy->readWholeFile(jmmt::synth::getFileName(package, 0)) == jmmt::synth::getFileData(package, 0));
+		mcoNoUnitAssert(fs->getStats().memoryInUse > memoryInUse);
+		mcoNoUnitAssert(checkPackage(lazy, package));
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(imageCacheRoundTrips, "packages read back the same when served from a package image") {
+	auto root = makeTestRoot("synth_image_cache");
+	auto package = makePackageOptions("IMAGE.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { package } }));
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+	fs->setImageCachePath(root / "image_cache");
+
+	// Images are only written on request, which is worthwhile once every file has been read in full.
+	auto first = fs->openPackageFile(package.name);
+	mcoNoUnitAssert(first != nullptr);
+	mcoNoUnitAssert(!first->hasImage());
+	mcoNoUnitAssert(checkPackage(first, package));
+	mcoNoUnitAssert(first->isFullyRead());
+	mcoNoUnitAssert(!first->hasImage());
+	mcoNoUnitAssert(first->writeImageCache());
+	mcoNoUnitAssert(first->hasImage());
+
+	// Later opens are served from it, without decoding anything.
+	auto decodedBefore = fs->getStats().compressedChunksDecoded + fs->getStats().uncompressedChunksDecoded;
+	auto second = fs->openPackageFile(package.name, jmmt::fs::PakFileSystem::InitLazy);
+	mcoNoUnitAssert(second != nullptr);
+	mcoNoUnitAssert(second->hasImage());
+	mcoNoUnitAssert(checkPackage(second, package));
+	mcoNoUnitAssert(fs->getStats().compressedChunksDecoded + fs->getStats().uncompressedChunksDecoded == decodedBefore);
+
+	auto name = jmmt::synth::getFileName(package, 7);
+	auto imageData = second->getImageFileData(name);
+	mcoNoUnitAssert(imageData.has_value());
+	mcoNoUnitAssert(std::vector<u8>(imageData->begin(), imageData->end()) == jmmt::synth::getFileData(package, 7));
+	mcoNoUnitAssert(second->readWholeFile(name) == jmmt::synth::getFileData(package, 7));
+
+	// Writing the image again leaves the one being served alone, so views into it and open files stay valid.
+	auto handle = second->fileOpen(name);
+	mcoNoUnitAssert(handle >= 0);
+	mcoNoUnitAssert(second->writeImageCache());
+	mcoNoUnitAssert(fs->getStats().compressedChunksDecoded + fs->getStats().uncompressedChunksDecoded == decodedBefore);
+	mcoNoUnitAssert(std::vector<u8>(imageData->begin(), imageData->end()) == jmmt::synth::getFileData(package, 7));
+	std::vector<u8> data(second->fileGetSize(handle));
+	mcoNoUnitAssert(second->fileRead(handle, data.data(), static_cast<u32>(data.size())) == static_cast<i32>(data.size()));
+	mcoNoUnitAssert(data == jmmt::synth::getFileData(package, 7));
+	second->fileClose(handle);
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(prefetchPlanRoundTrips, "access traces record reads, and replay as prefetch plans") {
+	auto root = makeTestRoot("synth_prefetch");
+	auto package = makePackageOptions("PREFETCH.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { package } }));
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+
+	// Record reading every other file, backwards.
+	auto recorded = fs->openPackageFile(package.name);
+	mcoNoUnitAssert(recorded != nullptr);
+	recorded->startAccessTrace();
+	u32 nChunks = 0;
+	for(u32 i = package.fileCount; i-- > 0;) {
+		if(i % 2 != 0)
+			continue;
+		mcoNoUnitAssert(recorded->readWholeFile(jmmt::synth::getFileName(package, i)) == jmmt::synth::getFileData(package, i));
+		nChunks += std::max<u32>(1, (jmmt::synth::getFileSize(package, i) + 65535) / 65536);
+	}
+	auto trace = recorded->stopAccessTrace();
+	mcoNoUnitAssert(trace.entries.size() == package.fileCount / 2);
+	mcoNoUnitAssert(trace.entries[0].fileName == jmmt::synth::getFileName(package, package.fileCount - 2));
+
+	mcoNoUnitAssert(trace.save(root / "trace.txt"));
+	auto loaded = jmmt::fs::AccessTrace::load(root / "trace.txt");
+	mcoNoUnitAssert(loaded.has_value() && loaded->entries.size() == trace.entries.size());
+	mcoNoUnitAssert(loaded->entries.back().fileName == trace.entries.back().fileName);
+	mcoNoUnitAssert(loaded->entries.back().length == trace.entries.back().length);
+
+	// With a budget big enough for the whole plan, every chunk is prefetched before the files are read.
+	auto replayed = fs->openPackageFile(package.name);
+	mcoNoUnitAssert(replayed != nullptr);
+	replayed->setPrefetchPlan(*loaded, 1ull << 30);
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while(replayed->getStats().compressedChunksDecoded + replayed->getStats().uncompressedChunksDecoded < nChunks && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	for(u32 i = package.fileCount; i-- > 0;)
+		if(i % 2 == 0)
+			mcoNoUnitAssert(replayed->readWholeFile(jmmt::synth::getFileName(package, i)) == jmmt::synth::getFileData(package, i));
+	mcoNoUnitAssert(replayed->getStats().prefetchHits == nChunks);
+	mcoNoUnitAssert(replayed->getStats().prefetchMisses == 0);
+	mcoNoUnitAssert(checkPackage(replayed, package));
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(overlayShadowsPackages, "loose files shadow package files of the same name") {
+	auto root = makeTestRoot("synth_overlay");
+	auto package = makePackageOptions("OVERLAY.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { package } }));
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+
+	// Loose file names don't have to match the case of the package's.
+	auto looseRoot = root / "loose";
+	auto overridePath = looseRoot / "SYNTH" / "Overlay" / "FILE0000000.BIN";
+	std::filesystem::create_directories(overridePath.parent_path());
+	{
+		auto str = overridePath.string();
+		auto stream = mco::FileStream::open(str.c_str(), mco::FileStream::ReadWrite | mco::FileStream::Create);
+		stream.write("loose", 5);
+	}
+
+	jmmt::fs::OverlayFileSystem overlay(fs);
+	mcoNoUnitAssert(overlay.addAllPackages());
+	mcoNoUnitAssert(overlay.addLooseRoot(looseRoot));
+
+	auto overridden = jmmt::synth::getFileName(package, 0);
+	mcoNoUnitAssert(overlay.resolve(overridden)->isLoose());
+	mcoNoUnitAssert(overlay.readWholeFile(overridden) == std::vector<u8>({ 'l', 'o', 'o', 's', 'e' }));
+
+	auto stream = overlay.openFile(jmmt::synth::getFileName(package, 1));
+	mcoNoUnitAssert(stream != nullptr);
+	std::vector<u8> data(jmmt::synth::getFileSize(package, 1));
+	mcoNoUnitAssert(stream->read(data.data(), data.size()) == data.size());
+	mcoNoUnitAssert(data == jmmt::synth::getFileData(package, 1));
+	mcoNoUnitAssert(!overlay.exists("synth\\overlay\\missing.bin"));
+
+	// Removing the loose file uncovers the package's again once the roots are rescanned.
+	std::filesystem::remove(overridePath);
+	mcoNoUnitAssert(overlay.rescanLooseRoots());
+	mcoNoUnitAssert(!overlay.resolve(overridden)->isLoose());
+	mcoNoUnitAssert(overlay.readWholeFile(overridden) == jmmt::synth::getFileData(package, 0));
+
+	// Dangling symlinks are skipped, but entries which can't be looked at fail the scan instead of throwing.
+	std::error_code ec;
+	std::filesystem::create_symlink(root / "nowhere", looseRoot / "dangling", ec);
+	if(!ec) {
+		mcoNoUnitAssert(overlay.rescanLooseRoots());
+		std::filesystem::create_symlink(looseRoot / "loop", looseRoot / "loop", ec);
+		mcoNoUnitAssert(!overlay.rescanLooseRoots());
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(truncatedIndexCacheIsSafe, "files whose chunks are missing from an index cache fail to open") {
+	auto root = makeTestRoot("synth_truncated_cache");
+	auto package = makePackageOptions("TRUNCATED.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { package } }));
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+	fs->setIndexCachePath(root / "index_cache");
+	mcoNoUnitAssert(fs->openPackageFile(package.name) != nullptr);
+
+	// Cut the cached chunk table in half. The rest of the cache stays valid, so it's still adopted.
+	auto cachePath = std::filesystem::directory_iterator(root / "index_cache")->path();
+	{
+		auto cache = mco::FileStream::open(cachePath.string().c_str(), mco::FileStream::ReadWrite);
+		u32 chunkCount {};
+		cache.seek(offsetof(jmmt::fs::PakIndexCacheHeader, chunkCount), mco::Stream::Begin);
+		mcoNoUnitAssert(cache.read(&chunkCount, sizeof(chunkCount)) == sizeof(chunkCount));
+		chunkCount /= 2;
+		cache.seek(offsetof(jmmt::fs::PakIndexCacheHeader, chunkCount), mco::Stream::Begin);
+		mcoNoUnitAssert(cache.write(&chunkCount, sizeof(chunkCount)) == sizeof(chunkCount));
+	}
+
+	auto pak = fs->openPackageFile(package.name);
+	mcoNoUnitAssert(pak != nullptr);
+
+	u32 nFailed = 0;
+	for(u32 i = 0; i < package.fileCount; ++i) {
+		if(auto data = pak->readWholeFile(jmmt::synth::getFileName(package, i)); data)
+			mcoNoUnitAssert(*data == jmmt::synth::getFileData(package, i));
+		else
+			nFailed++;
+	}
+	mcoNoUnitAssert(nFailed != 0 && nFailed < package.fileCount);
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(fileIndexFindsPackages, "the game file index finds the package holding every file") {
+	auto root = makeTestRoot("synth_file_index");
+	auto first = makePackageOptions("FIRST.PAK", 0.5f);
+	auto second = makePackageOptions("SECOND.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { first, second } }));
+
+	// The second filesystem loads the index the first one saved.
+	for(u32 i = 0; i < 2; ++i) {
+		auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+		mcoNoUnitAssert(fs != nullptr);
+		fs->setIndexCachePath(root / "index_cache");
+		mcoNoUnitAssert(!fs->hasFileIndex());
+		mcoNoUnitAssert(fs->buildFileIndex());
+
+		for(auto* pPackage : { &first, &second }) {
+			for(u32 j = 0; j < pPackage->fileCount; j += 7) {
+				auto name = jmmt::synth::getFileName(*pPackage, j);
+				mcoNoUnitAssert(fs->findFilePackage(name) == pPackage->name);
+
+				auto stream = fs->openPackagedFile(name);
+				mcoNoUnitAssert(stream != nullptr);
+				std::vector<u8> data(stream->getSize());
+				mcoNoUnitAssert(stream->read(data.data(), data.size()) == data.size());
+				mcoNoUnitAssert(data == jmmt::synth::getFileData(*pPackage, j));
+			}
+		}
+
+		mcoNoUnitAssert(!fs->findFilePackage("synth\\first\\missing.bin").has_value());
+		mcoNoUnitAssert(fs->openPackagedFile("synth\\first\\missing.bin") == nullptr);
+		mcoNoUnitAssert(!std::filesystem::is_empty(root / "index_cache"));
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(memoryLimitDegradesToStreaming, "packages read back the same within a memory limit") {
+	auto root = makeTestRoot("synth_memory_limit");
+	auto package = makePackageOptions("MEMORY.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { package } }));
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+
+	// Unlimited, files read ahead as far as they're allowed to.
+	{
+		auto pak = fs->openPackageFile(package.name);
+		mcoNoUnitAssert(pak != nullptr);
+		mcoNoUnitAssert(checkPackage(pak, package));
+		mcoNoUnitAssert(fs->getStats().memoryBudgetDenials == 0);
+	}
+	mcoNoUnitAssert(fs->getStats().memoryInUse == 0);
+	auto unlimitedPeak = fs->getStats().peakMemoryInUse;
+	mcoNoUnitAssert(unlimitedPeak != 0);
+
+	// With the limit already spent by the index, files fall back to reading a chunk at a time.
+	fs->setMemoryLimit(1);
+	{
+		auto pak = fs->openPackageFile(package.name);
+		mcoNoUnitAssert(pak != nullptr);
+		mcoNoUnitAssert(checkPackage(pak, package));
+		mcoNoUnitAssert(fs->getStats().memoryBudgetDenials != 0);
+		mcoNoUnitAssert(pak->getStats().memoryInUse != 0);
+	}
+	mcoNoUnitAssert(fs->getStats().memoryInUse == 0);
+	mcoNoUnitAssert(fs->getStats().peakMemoryInUse == unlimitedPeak);
+
+	// Prefetching counts a chunk it can't fit as one denial, no matter how often it wakes up waiting for room.
+	{
+		auto pak = fs->openPackageFile(package.name);
+		mcoNoUnitAssert(pak != nullptr);
+		pak->startAccessTrace();
+		mcoNoUnitAssert(checkPackage(pak, package));
+		auto trace = pak->stopAccessTrace();
+
+		u32 nChunks = 0;
+		for(u32 i = 0; i < package.fileCount; ++i)
+			nChunks += std::max<u32>(1, (jmmt::synth::getFileSize(package, i) + 65535) / 65536);
+
+		auto statsBefore = fs->getStats();
+		pak->setPrefetchPlan(trace);
+		mcoNoUnitAssert(checkPackage(pak, package));
+		pak->setPrefetchPlan({});
+		auto statsAfter = fs->getStats();
+		mcoNoUnitAssert(statsAfter.memoryBudgetDenials - statsBefore.memoryBudgetDenials <= nChunks + (statsAfter.fileOpens - statsBefore.fileOpens));
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(directoryIndexResolvesHashedNames, "game files resolve by hashed and clear names from the directory listing") {
+	auto root = makeTestRoot("synth_directory_index");
+	auto package = makePackageOptions("HASHED.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { package } }));
+
+	// Like the retail game, name package.toc by its name hash.
+	auto hashedTocPath = root / "DATA" / std::format("{:X}.DAT", jmmt::hashString("package.toc"));
+	std::filesystem::rename(root / "DATA" / "package.toc", hashedTocPath);
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+	mcoNoUnitAssert(fs->getFilePath("package.toc") == hashedTocPath);
+	mcoNoUnitAssert(fs->getFilePath("hashed.pak") == root / "DATA" / "HASHED.PAK");
+	mcoNoUnitAssert(fs->getFilePath("MISSING.PAK") == root / "DATA" / "MISSING.PAK");
+
+	// Files which show up later are only seen after a rescan.
+	auto hashedPakPath = root / "DATA" / std::format("{:X}.DAT", jmmt::hashString(package.name));
+	std::filesystem::rename(root / "DATA" / package.name, hashedPakPath);
+	mcoNoUnitAssert(fs->getFilePath(package.name) == root / "DATA" / package.name);
+	mcoNoUnitAssert(fs->rescanDirectories());
+	mcoNoUnitAssert(fs->getFilePath(package.name) == hashedPakPath);
+
+	auto pak = fs->openPackageFile(package.name);
+	mcoNoUnitAssert(pak != nullptr);
+	mcoNoUnitAssert(checkPackage(pak, package));
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(missingPackagesAreLeftOut, "packages missing from disk are left out of opening every package") {
+	auto root = makeTestRoot("synth_missing_package");
+	auto present = makePackageOptions("PRESENT.PAK", 0.5f);
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { present, makePackageOptions("MISSING.PAK", 0.5f) } }));
+	std::filesystem::remove(root / "DATA" / "MISSING.PAK");
+
+	auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+	mcoNoUnitAssert(fs != nullptr);
+
+	auto packages = fs->openAllPackages(4);
+	mcoNoUnitAssert(packages.size() == 1 && packages.contains(present.name));
+
+	// The file index is built from the packages that are there.
+	mcoNoUnitAssert(fs->buildFileIndex(4));
+	auto name = jmmt::synth::getFileName(present, 0);
+	mcoNoUnitAssert(fs->findFilePackage(name) == present.name);
+	mcoNoUnitAssert(fs->openPackagedFile(name) != nullptr);
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitDeclareTest(statsDumpStops, "periodic statistics dumps stop, and don't hold up destroying the filesystem") {
+	auto root = makeTestRoot("synth_stats_dump");
+	mcoNoUnitAssert(jmmt::synth::generateGameFileSystem(root, { .packages = { makePackageOptions("DUMP.PAK", 0.5f) } }));
+
+	std::atomic<u32> dumps {};
+	{
+		auto fs = jmmt::fs::createGameFileSystem(root, jmmt::synth::SyntheticGameVersion);
+		mcoNoUnitAssert(fs != nullptr);
+
+		fs->startStatsDump(std::chrono::milliseconds(5), [&](const jmmt::fs::Stats&) { ++dumps; });
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		fs->stopStatsDump();
+
+		// Nothing is dumped after stopping.
+		auto dumpsAtStop = dumps.load();
+		mcoNoUnitAssert(dumpsAtStop != 0);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		mcoNoUnitAssert(dumps.load() == dumpsAtStop);
+
+		// Destroying the filesystem stops a running dump too.
+		fs->startStatsDump(std::chrono::milliseconds(5), [&](const jmmt::fs::Stats&) { ++dumps; });
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+mcoNoUnitMain();
@@ -0,0 +1,60 @@
+#include <cstdio>
+#include <filesystem>
+#include <jmmt/fs/pak_writer.hpp>
+
+#include "cmd.hpp"
+#include "utils.hpp"
+
+namespace jmpak {
+
+	namespace {
+
+		void commandCompactHelp() {
+			std::printf(
+				"Rewrites a package without the dead space left behind by updates.\n"
+			);
+		}
+
+		int commandCompact(int argc, char** argv) {
+			if(argc != 1) {
+				std::printf("usage: k [packfile]\n");
+				return 1;
+			}
+
+			auto fs = getGameFileSystem();
+			if(!fs) {
+				std::printf("filesystem initalization failure\n");
+				return 1;
+			}
+
+			auto& packageMetadata = fs->getPackageMetadata();
+			auto* pCurrentMetadata = packageMetadata.find(argv[0]);
+			if(!pCurrentMetadata) {
+				std::printf("package \"%s\" is not in package.toc\n", argv[0]);
+				return 1;
+			}
+
+			auto pakPath = fs->getFilePath(argv[0], jmmt::fs::GameFileSystem::FileData);
+			std::error_code ec;
+			auto oldSize = std::filesystem::file_size(pakPath, ec);
+
+			jmmt::fs::PackageMetadata metadata {};
+			if(auto error = jmmt::fs::compactPackage(pakPath, *pCurrentMetadata, metadata); error != jmmt::fs::PakWriter::Success) {
+				std::printf("could not compact package \"%s\": %s\n", pakPath.string().c_str(), getPakWriterErrorString(error));
+				return 1;
+			}
+
+			auto tocPath = fs->getFilePath("package.toc", jmmt::fs::GameFileSystem::FileData);
+			if(!jmmt::fs::updatePackageToc(tocPath, argv[0], metadata)) {
+				std::printf("could not update \"%s\"\n", tocPath.string().c_str());
+				return 1;
+			}
+
+			auto newSize = std::filesystem::file_size(pakPath, ec);
+			std::printf("Compacted %s: %llu -> %llu bytes\n", pakPath.string().c_str(), static_cast<unsigned long long>(oldSize), static_cast<unsigned long long>(newSize));
+			return 0;
+		}
+	} // namespace
+
+	static Command cmdCompact('k', &commandCompactHelp, &commandCompact);
+} // namespace jmpak
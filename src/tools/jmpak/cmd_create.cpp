@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <filesystem>
+#include <jmmt/fs/pak_writer.hpp>
+
+#include "cmd.hpp"
+#include "utils.hpp"
+
+namespace jmpak {
+
+	namespace {
+
+		void commandCreateHelp() {
+			std::printf(
+				"Creates (or replaces) a package from a directory, and adds it to package.toc.\n"
+			);
+		}
+
+		int commandCreate(int argc, char** argv) {
+			if(argc != 2) {
+				std::printf("usage: c [directory] [packfile]\n");
+				return 1;
+			}
+
+			auto fs = getGameFileSystem();
+			if(!fs) {
+				std::printf("filesystem initalization failure\n");
+				return 1;
+			}
+
+			jmmt::fs::PakWriter writer;
+			if(!writer.addDirectory(argv[0])) {
+				std::printf("could not read directory \"%s\"\n", argv[0]);
+				return 1;
+			}
+
+			// Replace the package wherever the filesystem would open it from.
+			auto pakPath = fs->getFilePath(argv[1], jmmt::fs::GameFileSystem::FileData);
+			jmmt::fs::PackageMetadata metadata {};
+			if(auto error = writer.write(pakPath, metadata); error != jmmt::fs::PakWriter::Success) {
+				std::printf("could not write package \"%s\": %s\n", pakPath.string().c_str(), getPakWriterErrorString(error));
+				return 1;
+			}
+
+			auto tocPath = fs->getFilePath("package.toc", jmmt::fs::GameFileSystem::FileData);
+			if(!jmmt::fs::updatePackageToc(tocPath, argv[1], metadata)) {
+				std::printf("could not update \"%s\"\n", tocPath.string().c_str());
+				return 1;
+			}
+
+			std::printf("Wrote %zu files to %s\n", writer.getFileCount(), pakPath.string().c_str());
+			return 0;
+		}
+	} // namespace
+
+	static Command cmdCreate('c', &commandCreateHelp, &commandCreate);
+} // namespace jmpak
@@ -1,6 +1,7 @@
 #include <cstdio>
 #include <filesystem>
 #include <jmmt/fs/pak_filesystem.hpp>
+#include <jmmt/trace.hpp>
 #include <mco/utils.hpp>
 
 #include "cmd.hpp"
@@ -48,8 +49,9 @@ namespace jmpak {
 			if(!std::filesystem::exists(outputRoot))
 				std::filesystem::create_directories(outputRoot);
 
-			for(auto& [filename, meta] : pak->getMetadata()) {
-				auto filenameCopy = filename;
+			// Extracting in data order reads the package front to back.
+			for(auto file : pak->enumerateFiles(jmmt::fs::PakFileSystem::SortByOffset)) {
+				auto filenameCopy = std::string(file.name);
 				for(auto& c : filenameCopy)
 					if(c == '\\')
 						c = '/';
@@ -58,13 +60,21 @@ namespace jmpak {
 				if(auto parent = outPath.parent_path(); !std::filesystem::exists(parent))
 					std::filesystem::create_directories(parent);
 
-				auto pakFileStream = jmmt::fs::PakFileStream::open(pak, filename);
+				auto pakFileStream = jmmt::fs::PakFileStream::open(pak, file.name);
 				auto outputStream = mco::FileStream::open(outPath.string().c_str(), mco::FileStream::ReadWrite | mco::FileStream::Create);
-				mco::teeStreams(pakFileStream, outputStream, meta.fileSize);
+				{
+					// Reads show up nested inside this span; whatever isn't covered by them is writing.
+					JMMT_TRACE_SCOPE("jmpak extract file");
+					mco::teeStreams(pakFileStream, outputStream, file.metadata.fileSize);
+				}
 
 				printf("Extracted %s\n", outPath.string().c_str());
 			}
 
+			// Every file has been read now, so save an image for next time if image caching is enabled.
+			if(!fs->getImageCachePath().empty() && pak->isFullyRead())
+				pak->writeImageCache();
+
 			return 0;
 		}
 	} // namespace
@@ -26,7 +26,7 @@ namespace jmpak {
 			std::printf("Package files in filesystem:\n");
 
 			for(auto& [filename, metadata] : fs->getPackageMetadata()) {
-				std::printf("%s\n", filename.c_str());
+				std::printf("%.*s\n", static_cast<int>(filename.size()), filename.data());
 			}
 			return 0;
 		}
@@ -31,8 +31,8 @@ namespace jmpak {
 				return 1;
 			}
 
-			for(auto& [filename, meta] : pak->getMetadata()) {
-				std::printf("0x%08x %32s %8s\n", meta.dateStamp, filename.c_str(), mco::makeHumanReadableByteSize(meta.fileSize).c_str());
+			for(auto file : pak->enumerateFiles(jmmt::fs::PakFileSystem::SortByName)) {
+				std::printf("0x%08x %32.*s %8s\n", file.metadata.dateStamp, static_cast<int>(file.name.size()), file.name.data(), mco::makeHumanReadableByteSize(file.metadata.fileSize).c_str());
 			}
 
 			return 0;
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <filesystem>
+#include <jmmt/crc.hpp>
+#include <jmmt/fs/pak_filesystem.hpp>
+#include <jmmt/fs/pak_writer.hpp>
+#include <unordered_map>
+
+#include "cmd.hpp"
+#include "utils.hpp"
+
+namespace jmpak {
+
+	namespace {
+
+		void commandOptimizeHelp() {
+			std::printf(
+				"Reorders a package's data by an access trace (or by its package group), so files read together are stored together.\n"
+			);
+		}
+
+		void printSeekReport(const char* pName, const jmmt::fs::SeekReport& report) {
+			std::printf("%s: %llu chunks (%llu bytes) read, %llu seeks covering %llu bytes\n", pName,
+						static_cast<unsigned long long>(report.chunkReads), static_cast<unsigned long long>(report.bytesRead),
+						static_cast<unsigned long long>(report.seeks), static_cast<unsigned long long>(report.seekDistance));
+		}
+
+		int commandOptimize(int argc, char** argv) {
+			if(argc != 1 && argc != 2) {
+				std::printf("usage: o [packfile] [trace file (optional)]\n");
+				return 1;
+			}
+
+			auto fs = getGameFileSystem();
+			if(!fs) {
+				std::printf("filesystem initalization failure\n");
+				return 1;
+			}
+
+			auto& packageMetadata = fs->getPackageMetadata();
+			auto* pCurrentMetadata = packageMetadata.find(argv[0]);
+			if(!pCurrentMetadata) {
+				std::printf("package \"%s\" is not in package.toc\n", argv[0]);
+				return 1;
+			}
+			auto pakPath = fs->getFilePath(argv[0], jmmt::fs::GameFileSystem::FileData);
+
+			// Without a trace, lay files out in package group order, and report on reading every file in that order.
+			jmmt::fs::AccessTrace trace;
+			std::vector<u32> fileOrder;
+			if(argc == 2) {
+				auto loadedTrace = jmmt::fs::AccessTrace::load(argv[1]);
+				if(!loadedTrace) {
+					std::printf("could not read trace \"%s\"\n", argv[1]);
+					return 1;
+				}
+				trace = std::move(*loadedTrace);
+				fileOrder = jmmt::fs::getTraceFileOrder(trace);
+			} else {
+				auto pak = fs->openPackageFile(argv[0]);
+				if(!pak || !jmmt::fs::getPackageGroupFileOrder(pakPath, *pCurrentMetadata, fileOrder)) {
+					std::printf("could not open package file \"%s\"\n", argv[0]);
+					return 1;
+				}
+
+				std::unordered_map<u32, jmmt::fs::PakFileSystem::FileEntry> files;
+				for(auto file : pak->enumerateFiles())
+					files.emplace(jmmt::hashString(file.name), file);
+				for(auto nameHash : fileOrder)
+					if(auto file = files.find(nameHash); file != files.end())
+						trace.entries.push_back({ .fileName = std::string(file->second.name), .offset = 0, .length = file->second.metadata.fileSize, .timestamp = {} });
+			}
+
+			jmmt::fs::SeekReport before {};
+			if(!jmmt::fs::computeSeekReport(pakPath, *pCurrentMetadata, trace, before)) {
+				std::printf("could not read package \"%s\"\n", pakPath.string().c_str());
+				return 1;
+			}
+
+			jmmt::fs::PackageMetadata metadata {};
+			if(auto error = jmmt::fs::reorderPackage(pakPath, *pCurrentMetadata, metadata, fileOrder); error != jmmt::fs::PakWriter::Success) {
+				std::printf("could not reorder package \"%s\": %s\n", pakPath.string().c_str(), getPakWriterErrorString(error));
+				return 1;
+			}
+
+			auto tocPath = fs->getFilePath("package.toc", jmmt::fs::GameFileSystem::FileData);
+			if(!jmmt::fs::updatePackageToc(tocPath, argv[0], metadata)) {
+				std::printf("could not update \"%s\"\n", tocPath.string().c_str());
+				return 1;
+			}
+
+			jmmt::fs::SeekReport after {};
+			jmmt::fs::computeSeekReport(pakPath, metadata, trace, after);
+			printSeekReport("before", before);
+			printSeekReport("after", after);
+			return 0;
+		}
+	} // namespace
+
+	static Command cmdOptimize('o', &commandOptimizeHelp, &commandOptimize);
+} // namespace jmpak
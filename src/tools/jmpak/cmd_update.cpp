@@ -0,0 +1,62 @@
+#include <cstdio>
+#include <filesystem>
+#include <jmmt/fs/pak_writer.hpp>
+
+#include "cmd.hpp"
+#include "utils.hpp"
+
+namespace jmpak {
+
+	namespace {
+
+		void commandUpdateHelp() {
+			std::printf(
+				"Adds or replaces the files of a directory in an existing package, without rewriting the rest of it.\n"
+			);
+		}
+
+		int commandUpdate(int argc, char** argv) {
+			if(argc != 2) {
+				std::printf("usage: u [directory] [packfile]\n");
+				return 1;
+			}
+
+			auto fs = getGameFileSystem();
+			if(!fs) {
+				std::printf("filesystem initalization failure\n");
+				return 1;
+			}
+
+			auto& packageMetadata = fs->getPackageMetadata();
+			auto* pCurrentMetadata = packageMetadata.find(argv[1]);
+			if(!pCurrentMetadata) {
+				std::printf("package \"%s\" is not in package.toc\n", argv[1]);
+				return 1;
+			}
+
+			jmmt::fs::PakUpdater updater;
+			if(!updater.addDirectory(argv[0])) {
+				std::printf("could not read directory \"%s\"\n", argv[0]);
+				return 1;
+			}
+
+			auto pakPath = fs->getFilePath(argv[1], jmmt::fs::GameFileSystem::FileData);
+			jmmt::fs::PackageMetadata metadata {};
+			if(auto error = updater.update(pakPath, *pCurrentMetadata, metadata); error != jmmt::fs::PakWriter::Success) {
+				std::printf("could not update package \"%s\": %s\n", pakPath.string().c_str(), getPakWriterErrorString(error));
+				return 1;
+			}
+
+			auto tocPath = fs->getFilePath("package.toc", jmmt::fs::GameFileSystem::FileData);
+			if(!jmmt::fs::updatePackageToc(tocPath, argv[1], metadata)) {
+				std::printf("could not update \"%s\"\n", tocPath.string().c_str());
+				return 1;
+			}
+
+			std::printf("Updated %zu files in %s\n", updater.getFileCount(), pakPath.string().c_str());
+			return 0;
+		}
+	} // namespace
+
+	static Command cmdUpdate('u', &commandUpdateHelp, &commandUpdate);
+} // namespace jmpak
@@ -0,0 +1,46 @@
+#include <cstdio>
+
+#include "cmd.hpp"
+#include "utils.hpp"
+
+namespace jmpak {
+
+	namespace {
+
+		void commandWhichHelp() {
+			std::printf(
+				"Prints which package holds each of the given files.\n"
+			);
+		}
+
+		int commandWhich(int argc, char** argv) {
+			if(argc < 1) {
+				std::printf("usage: w [filename...]\n");
+				return 1;
+			}
+
+			auto fs = getGameFileSystem();
+			if(!fs) {
+				std::printf("filesystem initalization failure\n");
+				return 1;
+			}
+
+			if(!fs->buildFileIndex()) {
+				std::printf("could not build the game file index\n");
+				return 1;
+			}
+
+			for(int i = 0; i < argc; ++i) {
+				if(auto package = fs->findFilePackage(argv[i]); package.has_value()) {
+					std::printf("%s: %.*s\n", argv[i], static_cast<int>(package->size()), package->data());
+				} else {
+					std::printf("%s: not in any package\n", argv[i]);
+				}
+			}
+
+			return 0;
+		}
+	} // namespace
+
+	static Command cmdWhich('w', &commandWhichHelp, &commandWhich);
+} // namespace jmpak
@@ -1,12 +1,16 @@
 #include <cstdio>
+#include <cstring>
 
 #include "cmd.hpp"
+#include "utils.hpp"
 
 /// Usage function.
 void mainUsage(char* progname) {
 	std::printf(
 	"jmpak - LibJMMT package tool (c) 2025 modeco80\n"
-	"Usage: %s [command] [arguments...]\n"
+	"Usage: %s [--stats] [command] [arguments...]\n"
+	"Options:\n"
+	"--stats - print filesystem statistics at exit\n"
 	"Commands:\n",
 
 	progname);
@@ -20,9 +24,19 @@ void mainUsage(char* progname) {
 }
 
 int main(int argc, char** argv) {
+	auto progname = argv[0];
+
+	// Handle options which go before the command.
+	auto printStats = false;
+	if(argc >= 2 && !std::strcmp(argv[1], "--stats")) {
+		printStats = true;
+		--argc;
+		++argv;
+	}
+
 	// we need a command to run
 	if(argc < 2) {
-		mainUsage(argv[0]);
+		mainUsage(progname);
 		return 1;
 	}
 
@@ -30,12 +44,15 @@ int main(int argc, char** argv) {
 	if(auto cmd = jmpak::Command::find(argv[1][0]); cmd.has_value()) {
 		auto ret = (*cmd)->run(argc - 2, argv + 2);
 		if(ret != 0) {
-			mainUsage(argv[0]);
+			mainUsage(progname);
 		}
+
+		if(printStats)
+			jmpak::printStats();
 		return ret;
 	}
 
 	printf("Error: Unknown command '%c'.\n", argv[1][0]);
-	mainUsage(argv[0]);
+	mainUsage(progname);
 	return 1;
 }
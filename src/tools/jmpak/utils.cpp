@@ -1,8 +1,15 @@
 #include "utils.hpp"
 
+#include <cstdio>
+#include <cstdlib>
+#include <jmmt/synth/game_generator.hpp>
+
 namespace jmpak {
+	namespace {
+		Ref<jmmt::fs::GameFileSystem> ptr;
+	}
+
 	Ref<jmmt::fs::GameFileSystem> getGameFileSystem() {
-		static Ref<jmmt::fs::GameFileSystem> ptr;
 		std::filesystem::path path = std::filesystem::current_path();
 
 		if(!ptr) {
@@ -11,9 +18,89 @@ namespace jmpak {
 			if(env) {
 				path = env;
 			}
-			ptr = jmmt::fs::createGameFileSystem(path);
+
+			auto fs = std::make_shared<jmmt::fs::GameFileSystem>(path);
+
+			// Synthetic filesystems (see jmsynth) have no game ELF to detect the version from.
+			if(std::getenv("JMMT_SYNTHETIC_FS"))
+				fs->setAssumedVersion(jmmt::synth::SyntheticGameVersion);
+
+			// Use $JMMT_INDEX_CACHE as the package index cache directory if it exists. This is set before
+			// initializing, so version detection can use the cache too.
+			if(auto cacheEnv = std::getenv("JMMT_INDEX_CACHE"); cacheEnv) {
+				fs->setIndexCachePath(cacheEnv);
+			}
+
+			if(fs->initialize())
+				ptr = std::move(fs);
+
+			// Likewise, use $JMMT_IMAGE_CACHE as the decompressed package image cache directory.
+			if(auto imageCacheEnv = std::getenv("JMMT_IMAGE_CACHE"); ptr && imageCacheEnv) {
+				ptr->setImageCachePath(imageCacheEnv);
+			}
+
+			// Use $JMMT_MEMORY_LIMIT (in bytes) as the filesystem memory limit if it exists.
+			if(auto memoryLimitEnv = std::getenv("JMMT_MEMORY_LIMIT"); ptr && memoryLimitEnv) {
+				ptr->setMemoryLimit(std::strtoull(memoryLimitEnv, nullptr, 10));
+			}
 		}
 
 		return ptr;
 	}
+
+	void printStats() {
+		if(!ptr)
+			return;
+
+		// Make sure the statistics come after anything the command printed.
+		std::fflush(stdout);
+
+		auto stats = ptr->getStats();
+		auto ns = [](std::chrono::nanoseconds time) {
+			return static_cast<unsigned long long>(time.count());
+		};
+		auto ull = [](u64 value) {
+			return static_cast<unsigned long long>(value);
+		};
+
+		std::fprintf(stderr,
+					 "Filesystem statistics:\n"
+					 "  bytes read from disk: %llu (%llu reads, %llu seeks)\n"
+					 "  files opened: %llu\n"
+					 "  chunks decoded: %llu compressed, %llu uncompressed, %llu re-decoded\n"
+					 "  chunk decode time: %llu ns\n"
+					 "  read buffer: %llu hits, %llu misses\n"
+					 "  index cache: %llu hits, %llu misses\n"
+					 "  image cache: %llu hits, %llu misses\n"
+					 "  prefetch: %llu hits, %llu misses\n"
+					 "  memory: %llu bytes in use, %llu peak, %llu budget denials\n"
+					 "  fileRead: %llu calls, p50 <= %llu ns, p99 <= %llu ns\n",
+					 ull(stats.bytesRead), ull(stats.diskReads), ull(stats.diskSeeks),
+					 ull(stats.fileOpens),
+					 ull(stats.compressedChunksDecoded), ull(stats.uncompressedChunksDecoded), ull(stats.chunkRedecodes),
+					 ns(stats.decodeTime),
+					 ull(stats.readBufferHits), ull(stats.readBufferMisses),
+					 ull(stats.indexCacheHits), ull(stats.indexCacheMisses),
+					 ull(stats.imageCacheHits), ull(stats.imageCacheMisses),
+					 ull(stats.prefetchHits), ull(stats.prefetchMisses),
+					 ull(stats.memoryInUse), ull(stats.peakMemoryInUse), ull(stats.memoryBudgetDenials),
+					 ull(stats.fileReads), ns(stats.getFileReadLatencyPercentile(50)), ns(stats.getFileReadLatencyPercentile(99)));
+	}
+
+	const char* getPakWriterErrorString(jmmt::fs::PakWriter::Error error) {
+		switch(error) {
+			case jmmt::fs::PakWriter::DuplicateFile:
+				return "two files have the same (case-insensitive) name";
+			case jmmt::fs::PakWriter::FileTooLarge:
+				return "a file is too large to be stored in a package";
+			case jmmt::fs::PakWriter::PackageTooLarge:
+				return "the package would be larger than 4 GiB";
+			case jmmt::fs::PakWriter::ReadFailure:
+				return "reading a file failed";
+			case jmmt::fs::PakWriter::WriteFailure:
+				return "writing the package failed";
+			default:
+				return "unknown error";
+		}
+	}
 } // namespace jmpak
@@ -1,7 +1,14 @@
 #pragma once
 #include <jmmt/fs/game_filesystem.hpp>
+#include <jmmt/fs/pak_writer.hpp>
 
 namespace jmpak {
 	/// Obtains a global GameFileSystem which can be used in all of jmpak.
 	Ref<jmmt::fs::GameFileSystem> getGameFileSystem();
+
+	/// Prints the statistics of the global GameFileSystem to stderr, if it was ever created.
+	void printStats();
+
+	/// Describes a package writing error.
+	const char* getPakWriterErrorString(jmmt::fs::PakWriter::Error error);
 } // namespace jmpak
@@ -0,0 +1,77 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <jmmt/synth/game_generator.hpp>
+
+/// Usage function.
+void usage(char* progname) {
+	std::printf(
+	"jmsynth - LibJMMT synthetic game filesystem generator (c) 2025 modeco80\n"
+	"Usage: %s [options...] [root path]\n"
+	"Options:\n"
+	"--packages N         - number of packages (default 1)\n"
+	"--files N            - files per package (default 100)\n"
+	"--min-size N         - minimum file size in bytes (default 0)\n"
+	"--max-size N         - maximum file size in bytes (default 262144)\n"
+	"--compressibility F  - how compressible file data is, 0 to 1 (default 0.5)\n"
+	"--extra-strings N    - unreferenced strings to add to each string table (default 0)\n"
+	"--seed N             - random seed (default 0)\n"
+	"Synthetic filesystems have no game ELF. Use them with jmpak by setting JMMT_SYNTHETIC_FS=1,\n"
+	"or with libjmmt by passing version %s to createGameFileSystem().\n",
+	progname, jmmt::getVersionString(jmmt::synth::SyntheticGameVersion).c_str());
+}
+
+int main(int argc, char** argv) {
+	u32 nPackages = 1;
+	u32 seed = 0;
+	jmmt::synth::PackageOptions packageOptions;
+	const char* pRoot = nullptr;
+
+	for(int i = 1; i < argc; ++i) {
+		auto option = [&](const char* pName) {
+			return !std::strcmp(argv[i], pName) && i + 1 < argc;
+		};
+
+		if(option("--packages")) {
+			nPackages = std::strtoul(argv[++i], nullptr, 0);
+		} else if(option("--files")) {
+			packageOptions.fileCount = std::strtoul(argv[++i], nullptr, 0);
+		} else if(option("--min-size")) {
+			packageOptions.minFileSize = std::strtoul(argv[++i], nullptr, 0);
+		} else if(option("--max-size")) {
+			packageOptions.maxFileSize = std::strtoul(argv[++i], nullptr, 0);
+		} else if(option("--compressibility")) {
+			packageOptions.compressibility = std::strtof(argv[++i], nullptr);
+		} else if(option("--extra-strings")) {
+			packageOptions.extraStrings = std::strtoul(argv[++i], nullptr, 0);
+		} else if(option("--seed")) {
+			seed = std::strtoul(argv[++i], nullptr, 0);
+		} else if(argv[i][0] != '-' && !pRoot) {
+			pRoot = argv[i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if(!pRoot) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	jmmt::synth::GameOptions options;
+	for(u32 i = 0; i < nPackages; ++i) {
+		auto& package = options.packages.emplace_back(packageOptions);
+		package.name = std::format("SYNTH{}.PAK", i);
+		package.seed = seed + i;
+	}
+
+	if(!jmmt::synth::generateGameFileSystem(pRoot, options)) {
+		std::printf("Error: could not generate a synthetic filesystem in \"%s\"\n", pRoot);
+		return 1;
+	}
+
+	std::printf("Generated %u package(s) of %u file(s) in \"%s\"\n", nPackages, packageOptions.fileCount, pRoot);
+	return 0;
+}